@@ -0,0 +1,307 @@
+#include "bench.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "board.h"
+#include "hwcounters.h"
+#include "misc.h"
+#include "search.h"
+#include "transposition.h"
+#include "uci.h"
+
+// Fixed position suite, the total node count over it is the bench signature.
+// Changing this list (or the default depth) changes the signature.
+const char* const BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P3/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 3 54",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "8/8/8/8/8/6k1/6p1/6K1 w - - 0 1",
+    "7k/7P/6K1/8/3B4/8/8/8 b - - 0 1",
+};
+const size_t BENCH_FENS_LEN = sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]);
+
+// Searches a suite position from a cold TT and history, so the results don't
+// depend on the order the suite is run in
+static const search_ctx_t* search_position(const size_t i,
+                                           const uint8_t depth,
+                                           const hw_counters_t* counters) {
+  printf("\nPosition: %zu/%zu (%s)\n", i + 1, BENCH_FENS_LEN, BENCH_FENS[i]);
+
+  tt_clear();
+  search_clear();
+
+  const board_t board = from_fen(BENCH_FENS[i]);
+  const time_control_t time_control = {false, now_ms(), UINT64_MAX,
+                                       UINT64_MAX, 0};
+
+  move_t ponder_move = 0;
+  search_flag_store(ST_THINK);
+  if (counters) {
+    hw_counters_start(counters);
+  }
+  search_run(&board, time_control, depth, NULL, &ponder_move);
+  if (counters) {
+    hw_counters_stop(counters);
+  }
+  search_flag_store(ST_EXIT);
+
+  return search_main();
+}
+
+static uint8_t clamp_depth(const uint8_t depth) {
+  if (depth < 1) {
+    return 1;
+  }
+  return (depth >= MAX_PLY) ? (MAX_PLY - 1) : depth;
+}
+
+uint64_t bench(uint8_t depth, const size_t hash_mb, const bool hw_counters) {
+  depth = clamp_depth(depth);
+  tt_init(hash_mb);
+
+  hw_counters_t counters;
+  if (hw_counters && !hw_counters_open(&counters)) {
+    printf("info string hardware counters unavailable\n");
+  }
+
+  uint64_t total_nodes = 0;
+  const uint64_t start_ms = now_ms();
+#ifdef SEARCH_STATS
+  search_stats_t total_stats = {0};
+#endif
+
+  for (size_t i = 0; i < BENCH_FENS_LEN; i++) {
+    const search_ctx_t* ctx =
+        search_position(i, depth, hw_counters ? &counters : NULL);
+
+    total_nodes += search_nodes();
+#ifdef SEARCH_STATS
+    search_stats_add(&total_stats, &ctx->stats);
+#else
+    (void)ctx;
+#endif
+  }
+
+  const uint64_t elapsed_ms = now_ms() - start_ms + 1;
+
+#ifdef SEARCH_STATS
+  printf("\n");
+  last_search_stats = total_stats;
+  send_info_stats(&total_stats);
+#endif
+
+  printf("\n===========================\n");
+  printf("Total time (ms) : %" PRIu64 "\n", elapsed_ms);
+  printf("Nodes searched  : %" PRIu64 "\n", total_nodes);
+  printf("Nodes/second    : %" PRIu64 "\n", total_nodes * 1000 / elapsed_ms);
+  fflush(stdout);
+
+  if (hw_counters) {
+    hw_counters_read(&counters);
+    hw_counters_report(&counters, total_nodes);
+    hw_counters_close(&counters);
+  }
+
+  return total_nodes;
+}
+
+static bool load_baseline(const char* path, iteration_t* baseline) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return false;
+  }
+
+  char line[256];
+  while (fgets(line, sizeof line, file)) {
+    size_t position;
+    unsigned depth;
+    uint64_t nodes, time_ms;
+
+    // The header and malformed lines don't parse and are skipped
+    if (sscanf(line, "%zu,%u,%" SCNu64 ",%" SCNu64, &position, &depth, &nodes,
+               &time_ms) == 4 &&
+        position >= 1 && position <= BENCH_FENS_LEN && depth < MAX_PLY) {
+      iteration_t* entry = &baseline[(position - 1) * MAX_PLY + depth];
+      entry->nodes = nodes;
+      entry->time_ms = time_ms;
+    }
+  }
+
+  fclose(file);
+  return true;
+}
+
+typedef struct {
+  double log_nodes, log_time;
+  size_t len;
+} geomean_t;
+
+static void geomean_add(geomean_t* mean, const double nodes_ratio,
+                        const double time_ratio) {
+  mean->log_nodes += log(nodes_ratio);
+  mean->log_time += log(time_ratio);
+  mean->len++;
+}
+
+static void geomean_print(const char* label, const geomean_t* mean) {
+  if (mean->len == 0) {
+    printf("%-10s: no common positions\n", label);
+    return;
+  }
+  printf("%-10s: nodes x%.3f time x%.3f (%zu positions)\n", label,
+         exp(mean->log_nodes / mean->len), exp(mean->log_time / mean->len),
+         mean->len);
+}
+
+static void compare_baseline(const iteration_t* results,
+                             const iteration_t* baseline,
+                             const uint8_t* depths, const uint8_t depths_len) {
+  geomean_t total = {0, 0, 0};
+
+  printf("\n%3s %5s %12s %12s %7s %9s %9s %7s\n", "pos", "depth", "nodes",
+         "base nodes", "ratio", "time", "base time", "ratio");
+
+  for (uint8_t d = 0; d < depths_len; d++) {
+    const uint8_t depth = depths[d];
+    geomean_t depth_mean = {0, 0, 0};
+
+    for (size_t i = 0; i < BENCH_FENS_LEN; i++) {
+      const iteration_t* current = &results[i * MAX_PLY + depth];
+      const iteration_t* base = &baseline[i * MAX_PLY + depth];
+      if (current->nodes == 0 || base->nodes == 0) {
+        continue;
+      }
+
+      const double nodes_ratio = (double)current->nodes / base->nodes;
+      const double time_ratio = (double)current->time_ms / base->time_ms;
+      printf("%3zu %5d %12" PRIu64 " %12" PRIu64 " %7.3f %9" PRIu64
+             " %9" PRIu64 " %7.3f\n",
+             i + 1, depth, current->nodes, base->nodes, nodes_ratio,
+             current->time_ms, base->time_ms, time_ratio);
+
+      geomean_add(&depth_mean, nodes_ratio, time_ratio);
+      geomean_add(&total, nodes_ratio, time_ratio);
+    }
+
+    char label[16];
+    snprintf(label, sizeof label, "depth %d", depth);
+    geomean_print(label, &depth_mean);
+  }
+
+  printf("\n");
+  geomean_print("all", &total);
+}
+
+bool bench_suite(const uint8_t* depths, const uint8_t depths_len,
+                 const size_t hash_mb, const char* csv_path,
+                 const char* baseline_path) {
+  uint8_t max_depth = 1;
+  for (uint8_t d = 0; d < depths_len; d++) {
+    max_depth = (depths[d] > max_depth) ? depths[d] : max_depth;
+  }
+  max_depth = clamp_depth(max_depth);
+
+  FILE* csv = fopen(csv_path, "w");
+  if (csv == NULL) {
+    printf("info string cannot open %s\n", csv_path);
+    return false;
+  }
+
+  iteration_t* results = calloc(BENCH_FENS_LEN * MAX_PLY, sizeof(iteration_t));
+  iteration_t* baseline =
+      calloc(BENCH_FENS_LEN * MAX_PLY, sizeof(iteration_t));
+  if (results == NULL || baseline == NULL) {
+    printf("info string failed to allocate suite results\n");
+    free(results);
+    free(baseline);
+    fclose(csv);
+    return false;
+  }
+
+  tt_init(hash_mb);
+  fprintf(csv, "position,depth,nodes,time_ms\n");
+
+  // A single search per position to the deepest depth also records the
+  // shallower ones
+  for (size_t i = 0; i < BENCH_FENS_LEN; i++) {
+    const search_ctx_t* ctx = search_position(i, max_depth, NULL);
+
+    for (uint8_t d = 0; d < depths_len; d++) {
+      const uint8_t depth = depths[d];
+      if (depth < 1 || depth > ctx->completed_depth) {
+        continue;
+      }
+
+      results[i * MAX_PLY + depth] = ctx->iterations[depth];
+      fprintf(csv, "%zu,%d,%" PRIu64 ",%" PRIu64 "\n", i + 1, depth,
+              ctx->iterations[depth].nodes, ctx->iterations[depth].time_ms);
+    }
+    fflush(csv);
+  }
+  fclose(csv);
+
+  bool ok = true;
+  if (baseline_path != NULL) {
+    if (load_baseline(baseline_path, baseline)) {
+      compare_baseline(results, baseline, depths, depths_len);
+    } else {
+      printf("info string cannot open %s\n", baseline_path);
+      ok = false;
+    }
+  }
+  fflush(stdout);
+
+  free(results);
+  free(baseline);
+  return ok;
+}
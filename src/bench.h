@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_DEFAULT_DEPTH 8
+#define BENCH_DEFAULT_HASH 16
+
+extern const char* const BENCH_FENS[];
+extern const size_t BENCH_FENS_LEN;
+
+uint64_t bench(uint8_t depth, size_t hash_mb, bool hw_counters);
+bool bench_suite(const uint8_t* depths, uint8_t depths_len, size_t hash_mb,
+                 const char* csv_path, const char* baseline_path);
@@ -301,6 +301,31 @@ bool in_check(const board_t* board) {
                             board->side_to_move ^ 1, board, board->occupancy);
 }
 
+bitboard_t get_pinned(const board_t* board) {
+  const color_t us = board->side_to_move;
+  const square_t king = board->kings[us];
+  const bitboard_t enemies = board->occupancies[us ^ 1];
+  const bitboard_t queens = board->bitboards[PT_QUEEN];
+
+  bitboard_t snipers =
+      ((gen_piece_attacks(PT_ROOK, us, 0ULL, king) &
+        (board->bitboards[PT_ROOK] | queens)) |
+       (gen_piece_attacks(PT_BISHOP, us, 0ULL, king) &
+        (board->bitboards[PT_BISHOP] | queens))) &
+      enemies;
+  bitboard_t pinned = 0ULL;
+
+  while (snipers) {
+    const bitboard_t blockers =
+        gen_between(king, pop_lsb(&snipers)) & board->occupancy;
+    if (blockers && !more_than_one(blockers)) {
+      pinned |= blockers & board->occupancies[us];
+    }
+  }
+
+  return pinned;
+}
+
 static const square_t CASTLE_PATHS[NR_OF_COLORS][NR_OF_CASTLING_SIDES][3] = {
     // White
     {
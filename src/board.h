@@ -27,6 +27,7 @@ typedef struct {
 board_t from_fen(const char fen[]);
 bool was_legal(move_t move, const board_t* board);
 bool in_check(const board_t* board);
+bitboard_t get_pinned(const board_t* board);
 undo_t do_move(move_t move, board_t* board);
 void undo_move(undo_t undo, move_t move, board_t* board);
 square_t do_null_move(board_t* board);
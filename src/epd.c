@@ -0,0 +1,282 @@
+#include "epd.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitboard.h"
+#include "board.h"
+#include "defs.h"
+#include "misc.h"
+#include "movegen.h"
+#include "search.h"
+#include "transposition.h"
+#include "uci.h"
+
+#define EPD_LINE_LEN 1024
+#define EPD_MAX_MOVES 8
+#define EPD_ID_LEN 64
+
+typedef struct {
+  char fen[FEN_BUF_LEN];
+  char id[EPD_ID_LEN];
+  move_t best[EPD_MAX_MOVES];
+  move_t avoid[EPD_MAX_MOVES];
+  uint8_t best_len, avoid_len;
+} epd_t;
+
+static move_list_t gen_legal_moves(board_t* board) {
+  const move_list_t move_list = gen_color_moves(board);
+  move_list_t legal = {{0}, 0};
+
+  for (uint8_t i = 0; i < move_list.len; i++) {
+    const move_t move = move_list.moves[i];
+    const undo_t undo = do_move(move, board);
+    if (was_legal(move, board)) {
+      push_move(&legal, move);
+    }
+    undo_move(undo, move, board);
+  }
+
+  return legal;
+}
+
+void move_to_san(const board_t* board, const move_t move, char out[8]) {
+  static const char PIECE_CHARS[] = "PNBRQK";
+  const square_t from = get_from(move), to = get_to(move);
+  const uint8_t flags = get_flags(move);
+  const piece_t piece = board->mailbox[from];
+  uint8_t len = 0;
+
+  if (is_castling(move)) {
+    strcpy(out, (flags == FLAG_KING_SIDE) ? "O-O" : "O-O-O");
+    return;
+  }
+
+  if (piece == PT_PAWN) {
+    if (flags & FLAG_CAPTURE) {
+      out[len++] = (char)('a' + get_file(from));
+    }
+  } else {
+    out[len++] = PIECE_CHARS[piece];
+
+    // Disambiguate between pieces of the same type reaching the same square
+    board_t copy = *board;
+    const move_list_t legal = gen_legal_moves(&copy);
+    bool ambiguous = false, same_file = false, same_rank = false;
+
+    for (uint8_t i = 0; i < legal.len; i++) {
+      const square_t other = get_from(legal.moves[i]);
+      if (other == from || get_to(legal.moves[i]) != to ||
+          board->mailbox[other] != piece) {
+        continue;
+      }
+      ambiguous = true;
+      same_file |= get_file(other) == get_file(from);
+      same_rank |= get_rank(other) == get_rank(from);
+    }
+
+    if (ambiguous && (!same_file || same_rank)) {
+      out[len++] = (char)('a' + get_file(from));
+    }
+    if (ambiguous && same_file) {
+      out[len++] = (char)('1' + get_rank(from));
+    }
+  }
+
+  if (flags & FLAG_CAPTURE) {
+    out[len++] = 'x';
+  }
+  square_to_uci(to, out + len);
+  len += 2;
+
+  if (flags & FLAG_PROMOTION) {
+    out[len++] = '=';
+    out[len++] = (char)toupper(promo_to_char(decode_promotion(flags)));
+  }
+
+  out[len] = '\0';
+}
+
+// Strips check, annotation and promotion marks so "exd8=Q+" matches "exd8Q"
+static void normalize_san(const char* san, char* out, const size_t size) {
+  size_t len = 0;
+  for (; *san && len + 1 < size; san++) {
+    if (!strchr("+#!?=", *san)) {
+      out[len++] = *san;
+    }
+  }
+  out[len] = '\0';
+}
+
+static move_t parse_san(board_t* board, const char* san) {
+  char wanted[16];
+  normalize_san(san, wanted, sizeof wanted);
+
+  const move_list_t legal = gen_legal_moves(board);
+  for (uint8_t i = 0; i < legal.len; i++) {
+    char move_san[8], normalized[16], move_uci[6];
+    move_to_san(board, legal.moves[i], move_san);
+    normalize_san(move_san, normalized, sizeof normalized);
+    move_to_uci(legal.moves[i], move_uci);
+
+    if (strcmp(wanted, normalized) == 0 || strcmp(san, move_uci) == 0) {
+      return legal.moves[i];
+    }
+  }
+
+  return 0;
+}
+
+static uint8_t parse_moves(board_t* board, char* operands,
+                           move_t moves[EPD_MAX_MOVES]) {
+  uint8_t len = 0;
+  char* saveptr = NULL;
+
+  for (char* token = strtok_r(operands, " ", &saveptr);
+       token && len < EPD_MAX_MOVES; token = strtok_r(NULL, " ", &saveptr)) {
+    const move_t move = parse_san(board, token);
+    if (move) {
+      moves[len++] = move;
+    } else {
+      UCI_SEND("info string unknown epd move %s", token);
+    }
+  }
+
+  return len;
+}
+
+static bool parse_epd(char* line, epd_t* epd) {
+  *epd = (epd_t){{0}, {0}, {0}, {0}, 0, 0};
+
+  // The first four fields are the FEN without the move counters
+  char* rest = line;
+  for (uint8_t field = 0; field < 4; field++) {
+    while (*rest == ' ') {
+      rest++;
+    }
+    const size_t field_len = strcspn(rest, " ");
+    if (field_len == 0 ||
+        strlen(epd->fen) + field_len + 2 >= sizeof(epd->fen)) {
+      return false;
+    }
+    strncat(epd->fen, rest, field_len);
+    strcat(epd->fen, " ");
+    rest += field_len;
+  }
+  strcat(epd->fen, "0 1");
+
+  board_t board = from_fen(epd->fen);
+  char* saveptr = NULL;
+
+  for (char* op = strtok_r(rest, ";", &saveptr); op;
+       op = strtok_r(NULL, ";", &saveptr)) {
+    while (*op == ' ') {
+      op++;
+    }
+
+    if (strncmp(op, "bm ", 3) == 0) {
+      epd->best_len = parse_moves(&board, op + 3, epd->best);
+    } else if (strncmp(op, "am ", 3) == 0) {
+      epd->avoid_len = parse_moves(&board, op + 3, epd->avoid);
+    } else if (strncmp(op, "id ", 3) == 0) {
+      const char* id = op + 3;
+      const size_t id_len = strcspn(id + 1, "\"");
+      if (*id == '"') {
+        snprintf(epd->id, sizeof epd->id, "%.*s", (int)id_len, id + 1);
+      } else {
+        snprintf(epd->id, sizeof epd->id, "%s", id);
+      }
+    }
+  }
+
+  return epd->best_len > 0 || epd->avoid_len > 0;
+}
+
+static bool is_solution(const epd_t* epd, const move_t move) {
+  for (uint8_t i = 0; i < epd->avoid_len; i++) {
+    if (epd->avoid[i] == move) {
+      return false;
+    }
+  }
+  for (uint8_t i = 0; i < epd->best_len; i++) {
+    if (epd->best[i] == move) {
+      return true;
+    }
+  }
+  return epd->best_len == 0;
+}
+
+bool run_epd(const char* path, const uint64_t movetime_ms) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    UCI_SEND("info string cannot open %s", path);
+    return false;
+  }
+
+  char line[EPD_LINE_LEN];
+  uint32_t total = 0, solved = 0;
+  uint64_t solved_time_ms = 0, solved_nodes = 0;
+
+  while (fgets(line, sizeof line, file)) {
+    line[strcspn(line, "\r\n")] = 0;
+
+    epd_t epd;
+    if (!parse_epd(line, &epd)) {
+      continue;
+    }
+    total++;
+
+    tt_clear();
+    search_clear();
+
+    const board_t board = from_fen(epd.fen);
+    const time_control_t time_control = {false, now_ms(), movetime_ms,
+                                         movetime_ms, 0};
+
+    move_t ponder_move = 0;
+    search_flag_store(ST_THINK);
+    const move_t best_move =
+        search_run(&board, time_control, MAX_PLY - 1, NULL, &ponder_move);
+    search_flag_store(ST_EXIT);
+    const search_ctx_t* ctx = search_main();
+
+    // Solved at the first iteration from which the best move stayed correct
+    uint8_t solved_depth = 0;
+    for (uint8_t d = ctx->completed_depth; d >= 1; d--) {
+      if (!is_solution(&epd, ctx->iterations[d].best_move)) {
+        break;
+      }
+      solved_depth = d;
+    }
+
+    char san[8] = "(none)";
+    if (best_move) {
+      move_to_san(&board, best_move, san);
+    }
+
+    if (solved_depth > 0 && is_solution(&epd, best_move)) {
+      const iteration_t* first = &ctx->iterations[solved_depth];
+      solved++;
+      solved_time_ms += first->time_ms;
+      solved_nodes += first->nodes;
+      UCI_SEND("info string epd %s solved %s depth %d time %" PRIu64
+               " nodes %" PRIu64,
+               epd.id, san, solved_depth, first->time_ms, first->nodes);
+    } else {
+      UCI_SEND("info string epd %s failed %s", epd.id, san);
+    }
+  }
+  fclose(file);
+
+  UCI_SEND("info string epd solved %" PRIu32 "/%" PRIu32, solved, total);
+  if (solved > 0) {
+    UCI_SEND("info string epd average time %" PRIu64 " ms nodes %" PRIu64,
+             solved_time_ms / solved, solved_nodes / solved);
+  }
+
+  return true;
+}
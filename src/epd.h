@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "defs.h"
+
+void move_to_san(const board_t* board, move_t move, char out[8]);
+bool run_epd(const char* path, uint64_t movetime_ms);
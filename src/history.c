@@ -5,19 +5,76 @@
 
 #include "defs.h"
 
-history_h_t hh = {0};
-
-void hh_update(const move_t move, const int bonus, const board_t* board) {
+// Gravity keeps the entries within +-HISTORY_MAX
+static FORCE_INLINE void apply_bonus(int* entry, const int bonus) {
   const int clamped_bonus = (bonus < -HISTORY_MAX)  ? -HISTORY_MAX
                             : (bonus > HISTORY_MAX) ? HISTORY_MAX
                                                     : bonus;
-  int* entry = hh_get(move, board);
   *entry += clamped_bonus - (*entry * abs(clamped_bonus) / HISTORY_MAX);
 }
 
-int* hh_get(const move_t move, const board_t* board) {
+void hh_update(history_h_t* hh, const move_t move, const int bonus,
+               const board_t* board) {
+  apply_bonus(&hh->table[board->side_to_move][get_from(move)][get_to(move)],
+              bonus);
+}
+
+int hh_get(const history_h_t* hh, const move_t move, const board_t* board) {
   const square_t from = get_from(move), to = get_to(move);
-  return &hh[board->side_to_move][from][to];
+  return hh->table[board->side_to_move][from][to];
+}
+
+void hh_clear(history_h_t* hh) { memset(hh, 0, sizeof(history_h_t)); }
+
+void cm_update(counter_moves_t* cm, const piece_t prev_piece,
+               const square_t prev_to, const move_t move,
+               const board_t* board) {
+  cm->table[board->side_to_move][prev_piece][prev_to] = move;
+}
+
+move_t cm_get(const counter_moves_t* cm, const piece_t prev_piece,
+              const square_t prev_to, const board_t* board) {
+  return cm->table[board->side_to_move][prev_piece][prev_to];
+}
+
+void cm_clear(counter_moves_t* cm) { memset(cm, 0, sizeof(counter_moves_t)); }
+
+void ch_update(cont_history_t* ch, const piece_t prev_piece,
+               const square_t prev_to, const move_t move, const int bonus,
+               const board_t* board) {
+  const piece_t piece = board->mailbox[get_from(move)];
+  apply_bonus(&ch->table[board->side_to_move][prev_piece][prev_to][piece]
+                        [get_to(move)],
+              bonus);
 }
 
-void hh_clear(void) { memset(&hh, 0, sizeof(history_h_t)); }
+int ch_get(const cont_history_t* ch, const piece_t prev_piece,
+           const square_t prev_to, const move_t move, const board_t* board) {
+  const piece_t piece = board->mailbox[get_from(move)];
+  return ch->table[board->side_to_move][prev_piece][prev_to][piece]
+                  [get_to(move)];
+}
+
+void ch_clear(cont_history_t* ch) { memset(ch, 0, sizeof(cont_history_t)); }
+
+static FORCE_INLINE piece_t captured_type(const move_t move,
+                                          const board_t* board) {
+  return (get_flags(move) == FLAG_EP) ? PT_PAWN : board->mailbox[get_to(move)];
+}
+
+void caph_update(capture_history_t* caph, const move_t move, const int bonus,
+                 const board_t* board) {
+  apply_bonus(&caph->table[board->side_to_move][board->mailbox[get_from(move)]]
+                          [get_to(move)][captured_type(move, board)],
+              bonus);
+}
+
+int caph_get(const capture_history_t* caph, const move_t move,
+             const board_t* board) {
+  return caph->table[board->side_to_move][board->mailbox[get_from(move)]]
+                    [get_to(move)][captured_type(move, board)];
+}
+
+void caph_clear(capture_history_t* caph) {
+  memset(caph, 0, sizeof(capture_history_t));
+}
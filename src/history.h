@@ -5,10 +5,46 @@
 
 #define HISTORY_MAX 8192
 
-typedef int history_h_t[NR_OF_COLORS][NR_OF_SQUARES][NR_OF_SQUARES];
+typedef struct {
+  int table[NR_OF_COLORS][NR_OF_SQUARES][NR_OF_SQUARES];
+} history_h_t;
 
-extern history_h_t hh;
+// The quiet move that refuted a move, indexed by its piece and destination
+typedef struct {
+  move_t table[NR_OF_COLORS][NR_OF_PIECE_TYPES][NR_OF_SQUARES];
+} counter_moves_t;
 
-void hh_update(move_t move, int bonus, const board_t* board);
-int* hh_get(move_t move, const board_t* board);
-void hh_clear(void);
+// History of a quiet move following an earlier move of the line, indexed by
+// the piece and destination of both
+typedef struct {
+  int table[NR_OF_COLORS][NR_OF_PIECE_TYPES][NR_OF_SQUARES][NR_OF_PIECE_TYPES]
+           [NR_OF_SQUARES];
+} cont_history_t;
+
+// History of captures, indexed by the capturing piece, its destination and the
+// captured piece type
+typedef struct {
+  int table[NR_OF_COLORS][NR_OF_PIECE_TYPES][NR_OF_SQUARES][NR_OF_PIECE_TYPES];
+} capture_history_t;
+
+void hh_update(history_h_t* hh, move_t move, int bonus, const board_t* board);
+int hh_get(const history_h_t* hh, move_t move, const board_t* board);
+void hh_clear(history_h_t* hh);
+
+void cm_update(counter_moves_t* cm, piece_t prev_piece, square_t prev_to,
+               move_t move, const board_t* board);
+move_t cm_get(const counter_moves_t* cm, piece_t prev_piece, square_t prev_to,
+              const board_t* board);
+void cm_clear(counter_moves_t* cm);
+
+void ch_update(cont_history_t* ch, piece_t prev_piece, square_t prev_to,
+               move_t move, int bonus, const board_t* board);
+int ch_get(const cont_history_t* ch, piece_t prev_piece, square_t prev_to,
+           move_t move, const board_t* board);
+void ch_clear(cont_history_t* ch);
+
+void caph_update(capture_history_t* caph, move_t move, int bonus,
+                 const board_t* board);
+int caph_get(const capture_history_t* caph, move_t move,
+             const board_t* board);
+void caph_clear(capture_history_t* caph);
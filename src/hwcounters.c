@@ -0,0 +1,145 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "hwcounters.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* const HW_COUNTER_NAMES[HW_COUNTERS_LEN] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses",
+};
+
+#if defined(__linux__)
+
+typedef struct {
+  uint32_t type;
+  uint64_t config;
+} hw_event_t;
+
+static const hw_event_t HW_EVENTS[HW_COUNTERS_LEN] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+bool hw_counters_open(hw_counters_t* counters) {
+  bool any = false;
+
+  for (uint8_t i = 0; i < HW_COUNTERS_LEN; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = HW_EVENTS[i].type;
+    attr.config = HW_EVENTS[i].config;
+    attr.disabled = 1;
+    attr.inherit = 1;  // Also count search threads spawned later
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    counters->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    counters->values[i] = 0;
+    any |= counters->fds[i] >= 0;
+  }
+
+  return any;
+}
+
+void hw_counters_start(const hw_counters_t* counters) {
+  for (uint8_t i = 0; i < HW_COUNTERS_LEN; i++) {
+    if (counters->fds[i] >= 0) {
+      ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+void hw_counters_stop(const hw_counters_t* counters) {
+  for (uint8_t i = 0; i < HW_COUNTERS_LEN; i++) {
+    if (counters->fds[i] >= 0) {
+      ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+}
+
+void hw_counters_read(hw_counters_t* counters) {
+  for (uint8_t i = 0; i < HW_COUNTERS_LEN; i++) {
+    uint64_t data[3];  // value, time enabled, time running
+    if (counters->fds[i] < 0 ||
+        read(counters->fds[i], data, sizeof(data)) != sizeof(data)) {
+      continue;
+    }
+
+    // Scale up when the kernel had to multiplex the counters
+    counters->values[i] =
+        (data[2] > 0 && data[2] < data[1])
+            ? (uint64_t)((double)data[0] * data[1] / data[2])
+            : data[0];
+  }
+}
+
+void hw_counters_close(hw_counters_t* counters) {
+  for (uint8_t i = 0; i < HW_COUNTERS_LEN; i++) {
+    if (counters->fds[i] >= 0) {
+      close(counters->fds[i]);
+      counters->fds[i] = -1;
+    }
+  }
+}
+
+#else
+
+bool hw_counters_open(hw_counters_t* counters) {
+  for (uint8_t i = 0; i < HW_COUNTERS_LEN; i++) {
+    counters->fds[i] = -1;
+    counters->values[i] = 0;
+  }
+  return false;
+}
+
+void hw_counters_start(const hw_counters_t* counters) { (void)counters; }
+void hw_counters_stop(const hw_counters_t* counters) { (void)counters; }
+void hw_counters_read(hw_counters_t* counters) { (void)counters; }
+void hw_counters_close(hw_counters_t* counters) { (void)counters; }
+
+#endif
+
+void hw_counters_report(const hw_counters_t* counters, const uint64_t nodes) {
+  printf("\nHardware counters (per node)\n");
+
+  for (uint8_t i = 0; i < HW_COUNTERS_LEN; i++) {
+    if (counters->fds[i] < 0) {
+      printf("%-16s: n/a\n", HW_COUNTER_NAMES[i]);
+      continue;
+    }
+    printf("%-16s: %" PRIu64 " (%.2f)\n", HW_COUNTER_NAMES[i],
+           counters->values[i],
+           nodes ? (double)counters->values[i] / nodes : 0.0);
+  }
+
+  if (counters->fds[HW_CYCLES] >= 0 && counters->fds[HW_INSTRUCTIONS] >= 0 &&
+      counters->values[HW_CYCLES] > 0) {
+    printf("%-16s: %.2f\n", "IPC",
+           (double)counters->values[HW_INSTRUCTIONS] /
+               counters->values[HW_CYCLES]);
+  } else {
+    printf("%-16s: n/a\n", "IPC");
+  }
+  fflush(stdout);
+}
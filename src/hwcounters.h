@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  HW_CYCLES,
+  HW_INSTRUCTIONS,
+  HW_L1D_MISSES,
+  HW_LLC_MISSES,
+  HW_BRANCH_MISSES,
+
+  HW_COUNTERS_LEN
+} hw_counter_t;
+
+typedef struct {
+  int fds[HW_COUNTERS_LEN];
+  uint64_t values[HW_COUNTERS_LEN];
+} hw_counters_t;
+
+// Hardware counters are only implemented on Linux (perf_event_open), every
+// counter reads as unavailable elsewhere
+bool hw_counters_open(hw_counters_t* counters);
+void hw_counters_start(const hw_counters_t* counters);
+void hw_counters_stop(const hw_counters_t* counters);
+void hw_counters_read(hw_counters_t* counters);
+void hw_counters_close(hw_counters_t* counters);
+void hw_counters_report(const hw_counters_t* counters, uint64_t nodes);
@@ -1,16 +1,107 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
 #include "board.h"
+#include "epd.h"
+#include "perft.h"
+#include "search.h"
+#include "session.h"
 #include "transposition.h"
 #include "uci.h"
 #include "zobrist.h"
 
-int main(void) {
+// Strips `--threads N` and, for bench, `--perf` from anywhere after the
+// command, keeping the positional arguments in order. Fails on any other flag
+static bool parse_flags(int* argc, char* argv[], const bool allow_perf,
+                        uint16_t* threads, bool* hw_counters) {
+  int positional = 2;
+  for (int i = 2; i < *argc; i++) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < *argc) {
+      *threads = (uint16_t)atoi(argv[++i]);
+    } else if (allow_perf && strcmp(argv[i], "--perf") == 0) {
+      *hw_counters = true;
+    } else if (strncmp(argv[i], "--", 2) == 0) {
+      UCI_SEND("info string unknown argument %s", argv[i]);
+      return false;
+    } else {
+      argv[positional++] = argv[i];
+    }
+  }
+  *argc = positional;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
   init_zobrist_tables();
+  init_lmr_table();
+
+  const bool is_bench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  const bool is_suite = argc > 1 && strcmp(argv[1], "suite") == 0;
+  uint16_t threads = 1;
+  bool hw_counters = false;
+  if ((is_bench || is_suite) &&
+      !parse_flags(&argc, argv, is_bench, &threads, &hw_counters)) {
+    return 1;
+  }
+  search_init_threads(threads);
+
+  if (is_bench) {
+    const uint8_t depth =
+        (argc > 2) ? (uint8_t)atoi(argv[2]) : BENCH_DEFAULT_DEPTH;
+    const size_t hash_mb =
+        (argc > 3) ? (size_t)atoll(argv[3]) : BENCH_DEFAULT_HASH;
+    bench(depth, hash_mb, hw_counters);
+    return 0;
+  }
+
+  if (argc > 3 && is_suite) {
+    uint8_t depths[MAX_PLY];
+    uint8_t depths_len = 0;
+    for (char* token = strtok(argv[2], ","); token && depths_len < MAX_PLY;
+         token = strtok(NULL, ",")) {
+      depths[depths_len++] = (uint8_t)atoi(token);
+    }
+
+    const char* baseline_path = (argc > 4) ? argv[4] : NULL;
+    return bench_suite(depths, depths_len, BENCH_DEFAULT_HASH, argv[3],
+                       baseline_path)
+               ? 0
+               : 1;
+  }
+
+  if (argc > 3 && strcmp(argv[1], "epd") == 0) {
+    tt_init(DEFAULT_TT_SIZE);
+    return run_epd(argv[2], (uint64_t)atoll(argv[3])) ? 0 : 1;
+  }
+
+  if (argc > 1 && strcmp(argv[1], "perft") == 0) {
+    const uint8_t depth =
+        (argc > 2) ? (uint8_t)atoi(argv[2]) : PERFT_DEFAULT_DEPTH;
+    const uint16_t threads = (argc > 3) ? (uint16_t)atoi(argv[3]) : 1;
+    const size_t hash_mb = (argc > 4)      ? (size_t)atoll(argv[4])
+                           : (threads > 1) ? PERFT_DEFAULT_HASH
+                                           : 0;
+    return perft_suite(depth, threads, hash_mb) ? 0 : 1;
+  }
+
   tt_init(DEFAULT_TT_SIZE);
 
   engine_t engine = {
       from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"),
   };
 
+  if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+    return session_replay(argv[2], &engine) ? 0 : 1;
+  }
+
+  if (argc > 2 && strcmp(argv[1], "--record") == 0 &&
+      !session_record_start(argv[2])) {
+    return 1;
+  }
+
   uci_loop(&engine);
+  session_record_stop();
   return 0;
 }
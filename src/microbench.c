@@ -0,0 +1,283 @@
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "board.h"
+#include "defs.h"
+#include "eval.h"
+#include "misc.h"
+#include "movegen.h"
+#include "ordering.h"
+#include "search.h"
+#include "transposition.h"
+#include "zobrist.h"
+
+#define MIN_SAMPLE_NS 250000000ULL
+#define PLAYOUT_PLIES 8
+#define WAS_LEGAL_REPS 8
+#define ORDERING_REPS 16
+#define TT_KEYS (1 << 16)
+#define TT_SIZE_MB 16
+
+typedef struct {
+  board_t board;
+  move_list_t moves;
+} sample_t;
+
+// One pass over the corpus: returns the number of operations done and adds
+// the time spent on them to `elapsed_ns`
+typedef uint64_t (*round_fn_t)(uint64_t* elapsed_ns);
+
+static sample_t* corpus = NULL;
+static size_t corpus_len = 0;
+static uint64_t tt_keys[TT_KEYS];
+static search_ctx_t ctx;
+static volatile uint64_t sink = 0;
+
+// Pseudo-random legal move so the playouts reach varied positions
+static bool pick_legal_move(board_t* board, move_t* picked) {
+  const move_list_t move_list = gen_color_moves(board);
+  move_list_t legal = {{0}, 0};
+
+  for (uint8_t i = 0; i < move_list.len; i++) {
+    const move_t move = move_list.moves[i];
+    const undo_t undo = do_move(move, board);
+    if (was_legal(move, board)) {
+      push_move(&legal, move);
+    }
+    undo_move(undo, move, board);
+  }
+
+  if (legal.len == 0) {
+    return false;
+  }
+
+  *picked = legal.moves[random_u64() % legal.len];
+  return true;
+}
+
+static void build_corpus(void) {
+  corpus = malloc(BENCH_FENS_LEN * (PLAYOUT_PLIES + 1) * sizeof(sample_t));
+  if (corpus == NULL) {
+    fprintf(stderr, "failed to allocate corpus\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < BENCH_FENS_LEN; i++) {
+    board_t board = from_fen(BENCH_FENS[i]);
+
+    for (uint8_t ply = 0; ply <= PLAYOUT_PLIES; ply++) {
+      corpus[corpus_len++] = (sample_t){board, gen_color_moves(&board)};
+
+      move_t move;
+      if (!pick_legal_move(&board, &move) || is_draw(&board)) {
+        break;
+      }
+      do_move(move, &board);
+    }
+  }
+
+  for (size_t i = 0; i < TT_KEYS; i++) {
+    tt_keys[i] = random_u64();
+  }
+}
+
+static uint64_t round_gen_color_moves(uint64_t* elapsed_ns) {
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < corpus_len; i++) {
+    sink += gen_color_moves(&corpus[i].board).len;
+  }
+  *elapsed_ns += now_ns() - start;
+  return corpus_len;
+}
+
+static uint64_t round_gen_captures_only(uint64_t* elapsed_ns) {
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < corpus_len; i++) {
+    sink += gen_captures_only(&corpus[i].board).len;
+  }
+  *elapsed_ns += now_ns() - start;
+  return corpus_len;
+}
+
+static uint64_t round_do_undo(uint64_t* elapsed_ns) {
+  uint64_t ops = 0;
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < corpus_len; i++) {
+    board_t* board = &corpus[i].board;
+    const move_list_t* moves = &corpus[i].moves;
+
+    for (uint8_t j = 0; j < moves->len; j++) {
+      const undo_t undo = do_move(moves->moves[j], board);
+      sink += board->zobrist;
+      undo_move(undo, moves->moves[j], board);
+    }
+    ops += moves->len;
+  }
+  *elapsed_ns += now_ns() - start;
+  return ops;
+}
+
+// Includes a do_move/undo_move pair every WAS_LEGAL_REPS calls, its cost is
+// subtracted when reporting
+static uint64_t round_was_legal(uint64_t* elapsed_ns) {
+  uint64_t ops = 0;
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < corpus_len; i++) {
+    board_t* board = &corpus[i].board;
+    const move_list_t* moves = &corpus[i].moves;
+
+    for (uint8_t j = 0; j < moves->len; j++) {
+      const undo_t undo = do_move(moves->moves[j], board);
+      for (uint8_t r = 0; r < WAS_LEGAL_REPS; r++) {
+        sink += was_legal(moves->moves[j], board);
+      }
+      undo_move(undo, moves->moves[j], board);
+    }
+    ops += moves->len * WAS_LEGAL_REPS;
+  }
+  *elapsed_ns += now_ns() - start;
+  return ops;
+}
+
+static uint64_t round_in_check(uint64_t* elapsed_ns) {
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < corpus_len; i++) {
+    sink += in_check(&corpus[i].board);
+  }
+  *elapsed_ns += now_ns() - start;
+  return corpus_len;
+}
+
+static uint64_t round_is_draw(uint64_t* elapsed_ns) {
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < corpus_len; i++) {
+    sink += is_draw(&corpus[i].board);
+  }
+  *elapsed_ns += now_ns() - start;
+  return corpus_len;
+}
+
+static uint64_t round_static_eval(uint64_t* elapsed_ns) {
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < corpus_len; i++) {
+    sink += static_eval(&corpus[i].board);
+  }
+  *elapsed_ns += now_ns() - start;
+  return corpus_len;
+}
+
+static uint64_t round_tt_store(uint64_t* elapsed_ns) {
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < TT_KEYS; i++) {
+    tt_store(tt_keys[i], (move_t)i, (int)(i & 1023), i & 63, 0, BOUND_EXACT);
+  }
+  *elapsed_ns += now_ns() - start;
+  return TT_KEYS;
+}
+
+static uint64_t round_tt_probe(uint64_t* elapsed_ns) {
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < TT_KEYS; i++) {
+    sink += tt_probe(tt_keys[i]).depth;
+  }
+  *elapsed_ns += now_ns() - start;
+  return TT_KEYS;
+}
+
+// Only the ordering calls are timed, not the board copy into the context
+static uint64_t round_score_list(uint64_t* elapsed_ns) {
+  uint64_t ops = 0;
+  int scores[MAX_MOVES];
+  for (size_t i = 0; i < corpus_len; i++) {
+    ctx.board = corpus[i].board;
+
+    const uint64_t start = now_ns();
+    for (uint8_t r = 0; r < ORDERING_REPS; r++) {
+      score_list(&ctx, &corpus[i].moves, NULL, 0, scores);
+    }
+    *elapsed_ns += now_ns() - start;
+
+    sink += scores[0];
+    ops += ORDERING_REPS;
+  }
+  return ops;
+}
+
+static uint64_t round_next_move(uint64_t* elapsed_ns) {
+  uint64_t ops = 0;
+  int scores[MAX_MOVES];
+  for (size_t i = 0; i < corpus_len; i++) {
+    ctx.board = corpus[i].board;
+    score_list(&ctx, &corpus[i].moves, NULL, 0, scores);
+
+    for (uint8_t r = 0; r < ORDERING_REPS; r++) {
+      move_list_t moves = corpus[i].moves;
+      int moves_scores[MAX_MOVES];
+      for (uint8_t j = 0; j < moves.len; j++) {
+        moves_scores[j] = scores[j];
+      }
+
+      const uint64_t start = now_ns();
+      for (uint8_t j = 0; j < moves.len; j++) {
+        next_move(&moves, moves_scores, j);
+      }
+      *elapsed_ns += now_ns() - start;
+
+      sink += moves.moves[0];
+      ops += moves.len;
+    }
+  }
+  return ops;
+}
+
+static double run(const char* name, const round_fn_t round,
+                  const double overhead_ns) {
+  uint64_t ops = 0, elapsed_ns = 0;
+  const uint64_t start = now_ns();
+
+  // Warm up caches and branch predictors before sampling
+  round(&elapsed_ns);
+  elapsed_ns = 0;
+
+  while (now_ns() - start < MIN_SAMPLE_NS) {
+    ops += round(&elapsed_ns);
+  }
+
+  double ns_per_op = (double)elapsed_ns / ops - overhead_ns;
+  ns_per_op = (ns_per_op > 0.0) ? ns_per_op : 0.0;
+  const double ops_per_s = (ns_per_op > 0.0) ? 1e9 / ns_per_op : 0.0;
+
+  printf("%-20s %14" PRIu64 " %10.2f %14.0f\n", name, ops, ns_per_op,
+         ops_per_s);
+  fflush(stdout);
+
+  return ns_per_op;
+}
+
+int main(void) {
+  init_zobrist_tables();
+  tt_init(TT_SIZE_MB);
+  build_corpus();
+
+  printf("%zu positions\n\n", corpus_len);
+  printf("%-20s %14s %10s %14s\n", "primitive", "ops", "ns/op", "op/s");
+
+  run("gen_color_moves", round_gen_color_moves, 0.0);
+  run("gen_captures_only", round_gen_captures_only, 0.0);
+  const double do_undo_ns = run("do_move/undo_move", round_do_undo, 0.0);
+  run("was_legal", round_was_legal, do_undo_ns / WAS_LEGAL_REPS);
+  run("in_check", round_in_check, 0.0);
+  run("is_draw", round_is_draw, 0.0);
+  run("static_eval", round_static_eval, 0.0);
+  run("tt_store", round_tt_store, 0.0);
+  run("tt_probe", round_tt_probe, 0.0);
+  run("score_list", round_score_list, 0.0);
+  run("next_move", round_next_move, 0.0);
+
+  free(corpus);
+  return 0;
+}
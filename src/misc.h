@@ -29,6 +29,19 @@ static FORCE_INLINE uint64_t now_ms(void) {
   return (uint64_t)(t.QuadPart * 1000 / freq.QuadPart);
 }
 
+static FORCE_INLINE uint64_t now_ns(void) {
+  static LARGE_INTEGER freq;
+  static int init = 0;
+  if (!init) {
+    QueryPerformanceFrequency(&freq);
+    init = 1;
+  }
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+  return (uint64_t)(t.QuadPart / freq.QuadPart * 1000000000 +
+                    t.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart);
+}
+
 FORCE_INLINE int aligned_alloc_64(void** ptr, const size_t size) {
   *ptr = _aligned_malloc(size, 64);
   return *ptr ? 0 : -1;
@@ -47,6 +60,12 @@ FORCE_INLINE uint64_t now_ms(void) {
   return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+FORCE_INLINE uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 FORCE_INLINE int aligned_alloc_64(void** ptr, const size_t size) {
   return posix_memalign(ptr, 64, size);
 }
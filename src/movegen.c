@@ -185,3 +185,81 @@ move_list_t gen_captures_only(const board_t* board) {
 
   return move_list;
 }
+
+// Quiet moves of the piece on `from` landing on `targets`, promotions aside
+static FORCE_INLINE void gen_quiet_to(const board_t* __restrict board,
+                                      const square_t from,
+                                      const bitboard_t targets,
+                                      move_list_t* __restrict move_list) {
+  const color_t color = board->side_to_move;
+  const piece_t piece = board->mailbox[from];
+  const bitboard_t empty = ~board->occupancy;
+
+  if (piece != PT_PAWN) {
+    const bitboard_t attacks =
+        gen_piece_attacks(piece, color, board->occupancy, from);
+    splat_moves(from, attacks & empty & targets, FLAG_QUIET, move_list);
+    return;
+  }
+
+  const int8_t up = get_pawn_direction(color);
+  const square_t single = from + up, double_push = single + up;
+  const bitboard_t start_rank = (color == CLR_WHITE) ? R2 : R7;
+
+  if (!(bit(single) & empty & ~(R1 | R8))) {
+    return;
+  }
+  if (bit(single) & targets) {
+    push_move(move_list, new_move(from, single, FLAG_QUIET));
+  }
+  if ((bit(from) & start_rank) && (bit(double_push) & empty & targets)) {
+    push_move(move_list, new_move(from, double_push, FLAG_DOUBLE_PUSH));
+  }
+}
+
+void gen_quiet_checks(const board_t* __restrict board,
+                      move_list_t* __restrict move_list) {
+  const color_t us = board->side_to_move;
+  const square_t king = board->kings[us ^ 1];
+  const bitboard_t friendly = board->occupancies[us];
+  const bitboard_t queens = board->bitboards[PT_QUEEN];
+
+  // Squares from which each piece would attack the enemy king
+  bitboard_t check_squares[NR_OF_PIECE_TYPES] = {0};
+  check_squares[PT_PAWN] =
+      gen_piece_attacks(PT_PAWN, us ^ 1, board->occupancy, king);
+  for (piece_t piece = PT_KNIGHT; piece <= PT_QUEEN; piece++) {
+    check_squares[piece] =
+        gen_piece_attacks(piece, us, board->occupancy, king);
+  }
+
+  // Discovered checks: a lone friendly piece between one of our sliders and
+  // the enemy king checks by leaving the line
+  bitboard_t snipers =
+      ((gen_piece_attacks(PT_ROOK, us, 0ULL, king) &
+        (board->bitboards[PT_ROOK] | queens)) |
+       (gen_piece_attacks(PT_BISHOP, us, 0ULL, king) &
+        (board->bitboards[PT_BISHOP] | queens))) &
+      friendly;
+  bitboard_t discoverers = 0ULL;
+
+  while (snipers) {
+    const bitboard_t line = gen_between(king, pop_lsb(&snipers));
+    bitboard_t blockers = line & board->occupancy;
+    if (!blockers || more_than_one(blockers) || !(blockers & friendly)) {
+      continue;
+    }
+
+    discoverers |= blockers;
+    const square_t from = pop_lsb(&blockers);
+    gen_quiet_to(board, from, ~line | check_squares[board->mailbox[from]],
+                 move_list);
+  }
+
+  // Direct checks, the king can't give any
+  bitboard_t pieces = friendly & ~discoverers & ~board->bitboards[PT_KING];
+  while (pieces) {
+    const square_t from = pop_lsb(&pieces);
+    gen_quiet_to(board, from, check_squares[board->mailbox[from]], move_list);
+  }
+}
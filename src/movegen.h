@@ -2,6 +2,7 @@
 
 #include <assert.h>
 
+#include "bitboard.h"
 #include "board.h"
 #include "defs.h"
 #include "luts.h"
@@ -41,5 +42,19 @@ FORCE_INLINE bitboard_t gen_piece_attacks(const piece_t piece,
   return 0ULL;
 }
 
+// Squares strictly between two squares sharing a rank, file or diagonal
+FORCE_INLINE bitboard_t gen_between(const square_t a, const square_t b) {
+  const piece_t slider =
+      (gen_piece_attacks(PT_ROOK, CLR_WHITE, 0ULL, a) & bit(b)) ? PT_ROOK
+                                                                 : PT_BISHOP;
+  return gen_piece_attacks(slider, CLR_WHITE, bit(b), a) &
+         gen_piece_attacks(slider, CLR_WHITE, bit(a), b);
+}
+
 move_list_t gen_color_moves(const board_t* board);
 move_list_t gen_captures_only(const board_t* board);
+
+// Appends the quiet moves giving check, directly or by discovery. Castling
+// and promotions are left out
+void gen_quiet_checks(const board_t* __restrict board,
+                      move_list_t* __restrict move_list);
@@ -2,18 +2,40 @@
 
 #include "defs.h"
 #include "history.h"
+#include "ordering.h"
 #include "search.h"
+#include "see.h"
 #include "transposition.h"
 
 static const int PIECE_SCORE[NR_OF_PIECE_TYPES + 1] = {
     100, 300, 325, 500, 900, 0, 0,
 };
+// Capture history shifts a capture by up to HISTORY_MAX / 16 = 512, about a
+// rook of victim value. The bias keeps the term non-negative so it never
+// moves a capture out of its SEE class, which quiescence prunes on
+#define CAPTURE_HISTORY_DIV 16
+#define CAPTURE_HISTORY_BIAS (HISTORY_MAX / CAPTURE_HISTORY_DIV)
+
 static const int MVV_LVA[NR_OF_PIECE_TYPES][NR_OF_PIECE_TYPES] = {
     {109, 107, 107, 105, 101, 0}, {309, 307, 307, 305, 301, 0},
     {334, 332, 332, 330, 326, 0}, {509, 507, 507, 505, 501, 0},
     {909, 907, 907, 905, 901, 0}, {0, 0, 0, 0, 0, 0},
 };
 
+int quiet_history(const search_ctx_t* __restrict ctx, const move_t move,
+                  const uint8_t ply) {
+  const search_stack_t* ss = &ctx->stack[STACK_OFFSET + ply];
+  int score = hh_get(&ctx->hh, move, &ctx->board);
+  for (uint8_t i = 0; i < CONT_HISTORY_PLIES; i++) {
+    const search_stack_t* prev = ss - 1 - i;
+    if (prev->move) {
+      score += ch_get(&ctx->cont_history[i], prev->piece, get_to(prev->move),
+                      move, &ctx->board);
+    }
+  }
+  return score;
+}
+
 static FORCE_INLINE int score_move(const move_t move,
                                    const search_ctx_t* __restrict ctx,
                                    const tt_entry_t* __restrict entry,
@@ -32,21 +54,36 @@ static FORCE_INLINE int score_move(const move_t move,
                       (flags == FLAG_EP) ? PT_PAWN : ctx->board.mailbox[to],
                   attacker = ctx->board.mailbox[from];
 
-    return 20000 + MVV_LVA[victim][attacker] + PIECE_SCORE[promotion];
+    const int score =
+        MVV_LVA[victim][attacker] + PIECE_SCORE[promotion] +
+        CAPTURE_HISTORY_BIAS +
+        caph_get(&ctx->caph, move, &ctx->board) / CAPTURE_HISTORY_DIV;
+
+    return (promotion != PT_NONE || see_ge(&ctx->board, move, 0))
+               ? GOOD_CAPTURE_SCORE + score
+               : BAD_CAPTURE_SCORE + score;
   }
 
   if (flags & FLAG_PROMOTION) {
     const piece_t promotion = decode_promotion(flags);
-    return 20000 + PIECE_SCORE[promotion];
+    return GOOD_CAPTURE_SCORE + PIECE_SCORE[promotion] + CAPTURE_HISTORY_BIAS;
   }
 
-  if (ctx->killers[ply][0] == move) {
+  const search_stack_t* ss = &ctx->stack[STACK_OFFSET + ply];
+  if (ss->killers[0] == move) {
     return 10000;
-  } else if (ctx->killers[ply][1] == move) {
+  } else if (ss->killers[1] == move) {
     return 9000;
   }
 
-  return *hh_get(move, &ctx->board);
+  const search_stack_t* prev = ss - 1;
+  if (prev->move && cm_get(&ctx->counter_moves, prev->piece,
+                           get_to(prev->move), &ctx->board) == move) {
+    return 8500;
+  }
+
+  // Averaged to stay below the counter move
+  return quiet_history(ctx, move, ply) / (1 + CONT_HISTORY_PLIES);
 }
 
 void score_list(const search_ctx_t* __restrict ctx,
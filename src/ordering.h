@@ -6,6 +6,14 @@
 #include "search.h"
 #include "transposition.h"
 
+// Captures are split by SEE: the winning and even ones come before the
+// killers, the losing ones after every quiet move
+#define GOOD_CAPTURE_SCORE 20000
+#define BAD_CAPTURE_SCORE (-20000)
+
+// Butterfly history plus the continuation histories of the move
+int quiet_history(const search_ctx_t* __restrict ctx, move_t move,
+                  uint8_t ply);
 void score_list(const search_ctx_t* __restrict ctx,
                 const move_list_t* __restrict move_list,
                 const tt_entry_t* __restrict entry, const uint8_t ply,
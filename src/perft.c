@@ -0,0 +1,404 @@
+#include "perft.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitboard.h"
+#include "board.h"
+#include "defs.h"
+#include "misc.h"
+#include "movegen.h"
+#include "uci.h"
+
+#define PERFT_SUITE_MAX_DEPTH 6
+#define DEPTH_BITS 8
+#define DEPTH_MASK ((1ULL << DEPTH_BITS) - 1)
+
+// Lockless entry: `key` is stored xored with `data`, so a torn write from
+// another worker fails verification instead of returning a wrong count
+typedef struct {
+  _Atomic uint64_t key;
+  _Atomic uint64_t data;  // nodes << DEPTH_BITS | depth
+} perft_entry_t;
+
+typedef struct {
+  perft_entry_t* entries;
+  uint64_t mask;
+} perft_hash_t;
+
+typedef struct {
+  board_t board;
+  const move_list_t* root_moves;
+  uint64_t* root_nodes;
+  _Atomic uint16_t* next_root;
+  uint64_t nodes;
+  uint64_t busy_ms;
+  uint8_t root_moves_done;
+  uint8_t depth;
+} perft_worker_t;
+
+typedef struct {
+  const char* fen;
+  uint64_t nodes[PERFT_SUITE_MAX_DEPTH];
+} perft_position_t;
+
+// https://www.chessprogramming.org/Perft_Results
+static const perft_position_t PERFT_POSITIONS[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+     {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     {48, 2039, 97862, 4085603, 193690690, 0}},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     {14, 191, 2812, 43238, 674624, 11030083}},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     {6, 264, 9467, 422333, 15833292, 706045033}},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     {44, 1486, 62379, 2103487, 89941194, 0}},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     {46, 2079, 89890, 3894594, 164075551, 0}},
+};
+
+#define PERFT_POSITIONS_LEN \
+  (sizeof(PERFT_POSITIONS) / sizeof(PERFT_POSITIONS[0]))
+
+static perft_hash_t perft_hash = {NULL, 0};
+
+// Leaf nodes are counted without making the moves: when the side to move is
+// not in check, any move other than a king move, an en passant capture or a
+// move of a pinned piece is legal.
+static uint64_t perft_bulk(board_t* board) {
+  const move_list_t move_list = gen_color_moves(board);
+  const bitboard_t pinned = get_pinned(board);
+  const bool checked = in_check(board);
+  uint64_t nodes = 0;
+
+  for (uint8_t i = 0; i < move_list.len; i++) {
+    const move_t move = move_list.moves[i];
+    const square_t from = get_from(move);
+
+    if (!checked && board->mailbox[from] != PT_KING &&
+        get_flags(move) != FLAG_EP && !(bit(from) & pinned)) {
+      nodes++;
+      continue;
+    }
+
+    const undo_t undo = do_move(move, board);
+    nodes += was_legal(move, board);
+    undo_move(undo, move, board);
+  }
+
+  return nodes;
+}
+
+uint64_t perft(board_t* board, const uint8_t depth) {
+  if (depth == 0) {
+    return 1;
+  }
+  if (depth == 1) {
+    return perft_bulk(board);
+  }
+
+  const move_list_t move_list = gen_color_moves(board);
+  uint64_t nodes = 0;
+
+  for (uint8_t i = 0; i < move_list.len; i++) {
+    const move_t move = move_list.moves[i];
+    const undo_t undo = do_move(move, board);
+    if (was_legal(move, board)) {
+      nodes += perft(board, depth - 1);
+    }
+    undo_move(undo, move, board);
+  }
+
+  return nodes;
+}
+
+static bool perft_hash_init(const size_t mb) {
+  const size_t entries = mb * ((size_t)1 << 20) / sizeof(perft_entry_t);
+  size_t len = 1;
+  while ((len << 1) <= entries) {
+    len <<= 1;
+  }
+
+  if (aligned_alloc_64((void**)&perft_hash.entries,
+                       len * sizeof(perft_entry_t)) != 0) {
+    perft_hash = (perft_hash_t){NULL, 0};
+    return false;
+  }
+
+  memset(perft_hash.entries, 0, len * sizeof(perft_entry_t));
+  perft_hash.mask = len - 1;
+  return true;
+}
+
+static void perft_hash_free(void) {
+  if (perft_hash.entries) {
+    aligned_free(perft_hash.entries);
+  }
+  perft_hash = (perft_hash_t){NULL, 0};
+}
+
+static uint64_t perft_hashed(board_t* board, const uint8_t depth) {
+  if (depth <= 1) {
+    return perft(board, depth);
+  }
+
+  perft_entry_t* entry = &perft_hash.entries[board->zobrist & perft_hash.mask];
+  const uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+  const uint64_t key = atomic_load_explicit(&entry->key, memory_order_relaxed);
+  if ((key ^ data) == board->zobrist && (data & DEPTH_MASK) == depth) {
+    return data >> DEPTH_BITS;
+  }
+
+  const move_list_t move_list = gen_color_moves(board);
+  uint64_t nodes = 0;
+
+  for (uint8_t i = 0; i < move_list.len; i++) {
+    const move_t move = move_list.moves[i];
+    const undo_t undo = do_move(move, board);
+    if (was_legal(move, board)) {
+      nodes += perft_hashed(board, depth - 1);
+    }
+    undo_move(undo, move, board);
+  }
+
+  const uint64_t new_data = (nodes << DEPTH_BITS) | depth;
+  atomic_store_explicit(&entry->key, board->zobrist ^ new_data,
+                        memory_order_relaxed);
+  atomic_store_explicit(&entry->data, new_data, memory_order_relaxed);
+
+  return nodes;
+}
+
+static void* perft_worker(void* arg) {
+  perft_worker_t* worker = (perft_worker_t*)arg;
+  const uint64_t start_ms = now_ms();
+  uint16_t i;
+
+  while ((i = atomic_fetch_add(worker->next_root, 1)) <
+         worker->root_moves->len) {
+    const move_t move = worker->root_moves->moves[i];
+    const undo_t undo = do_move(move, &worker->board);
+
+    const uint64_t nodes = (perft_hash.entries != NULL)
+                               ? perft_hashed(&worker->board, worker->depth - 1)
+                               : perft(&worker->board, worker->depth - 1);
+    undo_move(undo, move, &worker->board);
+
+    worker->root_nodes[i] = nodes;
+    worker->nodes += nodes;
+    worker->root_moves_done++;
+  }
+
+  worker->busy_ms = now_ms() - start_ms;
+  return NULL;
+}
+
+uint64_t perft_parallel(const board_t* board, const uint8_t depth,
+                        uint16_t threads, const size_t hash_mb,
+                        const bool verbose) {
+  threads = (threads < 1) ? 1 : threads;
+  threads = (threads > PERFT_MAX_THREADS) ? PERFT_MAX_THREADS : threads;
+
+  if (depth == 0) {
+    return 1;
+  }
+
+  // Root moves are the units of work, so only the legal ones are handed out
+  board_t root = *board;
+  const move_list_t pseudo_legal = gen_color_moves(&root);
+  move_list_t root_moves = {{0}, 0};
+  for (uint8_t i = 0; i < pseudo_legal.len; i++) {
+    const move_t move = pseudo_legal.moves[i];
+    const undo_t undo = do_move(move, &root);
+    if (was_legal(move, &root)) {
+      push_move(&root_moves, move);
+    }
+    undo_move(undo, move, &root);
+  }
+
+  if (hash_mb > 0 && !perft_hash_init(hash_mb)) {
+    UCI_SEND("info string failed to allocate perft hash, running without");
+  }
+
+  uint64_t root_nodes[MAX_MOVES] = {0};
+  _Atomic uint16_t next_root = 0;
+  perft_worker_t* workers = malloc(threads * sizeof(perft_worker_t));
+  pthread_t* handles = malloc(threads * sizeof(pthread_t));
+  if (workers == NULL || handles == NULL) {
+    UCI_SEND("info string failed to allocate perft workers");
+    free(workers);
+    free(handles);
+    perft_hash_free();
+    return 0;
+  }
+
+  for (uint16_t t = 0; t < threads; t++) {
+    workers[t] = (perft_worker_t){
+        .board = *board,
+        .root_moves = &root_moves,
+        .root_nodes = root_nodes,
+        .next_root = &next_root,
+        .nodes = 0,
+        .busy_ms = 0,
+        .root_moves_done = 0,
+        .depth = depth,
+    };
+  }
+
+  // The calling thread works as worker 0
+  uint16_t spawned = 1;
+  for (; spawned < threads; spawned++) {
+    if (pthread_create(&handles[spawned], NULL, perft_worker,
+                       &workers[spawned]) != 0) {
+      UCI_SEND("info string error starting perft thread");
+      break;
+    }
+  }
+  perft_worker(&workers[0]);
+  for (uint16_t t = 1; t < spawned; t++) {
+    pthread_join(handles[t], NULL);
+  }
+
+  uint64_t nodes = 0;
+  for (uint8_t i = 0; i < root_moves.len; i++) {
+    nodes += root_nodes[i];
+  }
+
+  if (verbose) {
+    for (uint16_t t = 0; t < spawned; t++) {
+      printf("thread %d: root moves %d nodes %" PRIu64 " busy %" PRIu64
+             " ms\n",
+             t, workers[t].root_moves_done, workers[t].nodes,
+             workers[t].busy_ms);
+    }
+  }
+
+  free(workers);
+  free(handles);
+  perft_hash_free();
+
+  return nodes;
+}
+
+void perft_scaling(const board_t* board, const uint8_t depth,
+                   uint16_t max_threads, const size_t hash_mb) {
+  uint64_t base_ms = 0;
+  // perft_parallel() clamps the same way, the rows must match what it ran
+  max_threads =
+      (max_threads > PERFT_MAX_THREADS) ? PERFT_MAX_THREADS : max_threads;
+
+  printf("threads        nodes    time ms     Mnps  speedup  efficiency\n");
+  for (uint32_t threads = 1; threads <= max_threads;) {
+    const uint64_t start_ms = now_ms();
+    const uint64_t nodes = perft_parallel(board, depth, threads, hash_mb,
+                                          threads == max_threads);
+    const uint64_t elapsed_ms = now_ms() - start_ms + 1;
+    base_ms = (threads == 1) ? elapsed_ms : base_ms;
+
+    const double speedup = (double)base_ms / elapsed_ms;
+    printf("%7" PRIu32 " %12" PRIu64 " %10" PRIu64 " %8.2f %8.2f %10.0f%%\n", threads,
+           nodes, elapsed_ms, (double)nodes / elapsed_ms / 1000.0, speedup,
+           speedup / threads * 100);
+    fflush(stdout);
+
+    // Powers of two, always finishing on the requested thread count
+    threads = (threads < max_threads && threads * 2 > max_threads)
+                  ? max_threads
+                  : threads * 2;
+  }
+}
+
+static void print_speed(const uint64_t nodes, const uint64_t elapsed_ms) {
+  printf("Time (ms)       : %" PRIu64 "\n", elapsed_ms);
+  printf("Mnps            : %.2f\n", (double)nodes / (elapsed_ms + 1) / 1000.0);
+}
+
+uint64_t perft_report(const board_t* board, const uint8_t depth,
+                      const bool divide) {
+  board_t copy = *board;
+  const uint64_t start_ms = now_ms();
+  uint64_t nodes = 0;
+
+  if (!divide || depth == 0) {
+    nodes = perft(&copy, depth);
+  } else {
+    const move_list_t move_list = gen_color_moves(&copy);
+
+    for (uint8_t i = 0; i < move_list.len; i++) {
+      const move_t move = move_list.moves[i];
+      const undo_t undo = do_move(move, &copy);
+      if (was_legal(move, &copy)) {
+        const uint64_t move_nodes = perft(&copy, depth - 1);
+        char move_uci[6] = {0};
+        move_to_uci(move, move_uci);
+
+        printf("%s: %" PRIu64 "\n", move_uci, move_nodes);
+        nodes += move_nodes;
+      }
+      undo_move(undo, move, &copy);
+    }
+    putchar('\n');
+  }
+
+  const uint64_t elapsed_ms = now_ms() - start_ms;
+  printf("Nodes searched  : %" PRIu64 "\n", nodes);
+  print_speed(nodes, elapsed_ms);
+  fflush(stdout);
+
+  return nodes;
+}
+
+bool perft_suite(const uint8_t depth, const uint16_t threads,
+                 const size_t hash_mb) {
+  uint64_t total_nodes = 0;
+  uint8_t failed = 0;
+  const uint64_t start_ms = now_ms();
+
+  for (uint8_t i = 0; i < PERFT_POSITIONS_LEN; i++) {
+    const perft_position_t* position = &PERFT_POSITIONS[i];
+
+    // Clamp to the deepest known node count of the position
+    uint8_t position_depth = (depth > PERFT_SUITE_MAX_DEPTH)
+                                 ? PERFT_SUITE_MAX_DEPTH
+                                 : (depth < 1 ? 1 : depth);
+    while (position->nodes[position_depth - 1] == 0) {
+      position_depth--;
+    }
+
+    board_t board = from_fen(position->fen);
+    const uint64_t position_start_ms = now_ms();
+    const uint64_t nodes =
+        (threads > 1 || hash_mb > 0)
+            ? perft_parallel(&board, position_depth, threads, hash_mb, false)
+            : perft(&board, position_depth);
+    const uint64_t elapsed_ms = now_ms() - position_start_ms;
+    const uint64_t expected = position->nodes[position_depth - 1];
+    const bool ok = nodes == expected;
+
+    printf("%d. depth %d nodes %" PRIu64 " expected %" PRIu64
+           " %s time %" PRIu64 " ms %.2f Mnps (%s)\n",
+           i + 1, position_depth, nodes, expected, ok ? "OK" : "FAIL",
+           elapsed_ms, (double)nodes / (elapsed_ms + 1) / 1000.0,
+           position->fen);
+    fflush(stdout);
+
+    failed += !ok;
+    total_nodes += nodes;
+  }
+
+  printf("\n===========================\n");
+  printf("Positions failed: %d/%zu\n", failed, PERFT_POSITIONS_LEN);
+  printf("Nodes searched  : %" PRIu64 "\n", total_nodes);
+  print_speed(total_nodes, now_ms() - start_ms);
+  fflush(stdout);
+
+  return failed == 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define PERFT_DEFAULT_DEPTH 5
+#define PERFT_DEFAULT_HASH 64
+#define PERFT_MAX_THREADS 256
+
+uint64_t perft(board_t* board, uint8_t depth);
+uint64_t perft_report(const board_t* board, uint8_t depth, bool divide);
+uint64_t perft_parallel(const board_t* board, uint8_t depth, uint16_t threads,
+                        size_t hash_mb, bool verbose);
+void perft_scaling(const board_t* board, uint8_t depth, uint16_t max_threads,
+                   size_t hash_mb);
+bool perft_suite(uint8_t depth, uint16_t threads, size_t hash_mb);
@@ -1,9 +1,11 @@
 #include "search.h"
 
-#include <sched.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "board.h"
@@ -13,66 +15,314 @@
 #include "misc.h"
 #include "movegen.h"
 #include "ordering.h"
+#include "see.h"
+#include "telemetry.h"
 #include "transposition.h"
 #include "uci.h"
 
 #define TIME_CHECK_MASK 1023
+#define ASPIRATION_MIN_DEPTH 4
+#define ASPIRATION_WINDOW 25
+#define LMR_LEN 64
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 3
+#define LMR_HISTORY_DIV 4096
+#define SEE_PRUNE_DEPTH 6
+#define SEE_QUIET_MARGIN 60
+#define SEE_CAPTURE_MARGIN 20
+#define SINGULAR_MIN_DEPTH 8
+#define SINGULAR_TT_DEPTH 3
+#define SINGULAR_MARGIN 2
+#define IIR_MIN_DEPTH 3
+#define DELTA_MARGIN 200
+#define PROBCUT_MIN_DEPTH 5
+#define PROBCUT_REDUCTION 4
+#define PROBCUT_MARGIN 150
 
 volatile _Atomic search_flag_t SEARCH_FLAG = ST_EXIT;
+search_stats_t last_search_stats = {0};
+
+// Signaled on every flag change, see `wait_for_bestmove`
+static pthread_mutex_t flag_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flag_changed = PTHREAD_COND_INITIALIZER;
+
+static uint8_t lmr_table[LMR_LEN][LMR_LEN];
+
+// Frontier pruning margins, indexed by depth. Each rule only applies up to
+// the last depth its table covers
+static const int RFP_MARGIN[] = {0, 75, 150, 225, 300, 375, 450, 525, 600};
+static const int RAZOR_MARGIN[] = {0, 250, 500};
+static const int FUTILITY_MARGIN[] = {0, 100, 175, 250, 325};
+static const uint8_t LMP_MOVES[] = {0, 4, 7, 12, 19, 28, 39};
+#define TABLE_DEPTH(table) (sizeof(table) / sizeof((table)[0]) - 1)
+
+static search_ctx_t* searchers = NULL;  // `searchers[0]` is the main searcher
+static uint16_t searchers_len = 0;
+static uint8_t helpers_depth = 0;
+static uint8_t multi_pv = 1;
+static volatile _Atomic bool helpers_stop = false;
+
+// Helpers skip iterations in a staggered pattern so they spread over
+// several depths instead of all searching the main thread's
+static const uint8_t SKIP_SIZE[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                    3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const uint8_t SKIP_PHASE[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3,
+                                     4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+#define SKIP_LEN (sizeof(SKIP_SIZE) / sizeof(SKIP_SIZE[0]))
+
+static FORCE_INLINE bool is_stopped(void) {
+  return search_flag_load() == ST_EXIT ||
+         atomic_load_explicit(&helpers_stop, memory_order_relaxed);
+}
+
+static FORCE_INLINE bool skip_depth(const search_ctx_t* ctx,
+                                    const uint8_t depth) {
+  if (ctx->thread_id == 0) {
+    return false;
+  }
+  const uint8_t i = (ctx->thread_id - 1) % SKIP_LEN;
+  return ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2;
+}
+
+void init_lmr_table(void) {
+  for (uint8_t depth = 1; depth < LMR_LEN; depth++) {
+    for (uint8_t move = 1; move < LMR_LEN; move++) {
+      lmr_table[depth][move] =
+          (uint8_t)(0.75 + log((double)depth) * log((double)move) / 2.25);
+    }
+  }
+}
 
+// Only the main searcher owns the clock
 static FORCE_INLINE void check_ponderhit(search_ctx_t* ctx) {
-  if (search_flag_load() == ST_PONDERHIT) {
+  if (ctx->thread_id == 0 && search_flag_load() == ST_PONDERHIT) {
     ctx->time_control.start_ms = now_ms();
     ctx->time_control.timeout = false;
     search_flag_store(ST_THINK);
   }
 }
 
-static FORCE_INLINE void pv_update(pv_table_t* pv, const uint8_t ply,
-                                   const move_t best_move) {
-  pv->table[ply][0] = best_move;
-
-  if (ply + 1 >= MAX_PLY) {
-    pv->len[ply] = 1;
-    return;
+// The PV of a node is its best move followed by the child's PV
+static FORCE_INLINE void pv_update(move_t* pv, const move_t best_move,
+                                   const move_t* child) {
+  uint8_t len = 0;
+  pv[len++] = best_move;
+  for (; child != NULL && *child; child++) {
+    pv[len++] = *child;
   }
+  pv[len] = 0;
+}
 
-  const uint8_t child_len = pv->len[ply + 1];
-  pv->len[ply] = child_len + 1;
+// Only the searcher itself counts its nodes, so a relaxed load and store
+// are enough and keep the increment free of a locked instruction
+static FORCE_INLINE uint64_t nodes_load(const search_ctx_t* ctx) {
+  return atomic_load_explicit(&ctx->nodes, memory_order_relaxed);
+}
 
-  memcpy(&pv->table[ply][1], &pv->table[ply + 1][0],
-         child_len * sizeof(move_t));
+static FORCE_INLINE void nodes_inc(search_ctx_t* ctx) {
+  atomic_store_explicit(&ctx->nodes, nodes_load(ctx) + 1,
+                        memory_order_relaxed);
 }
 
+// Every searcher checks the node budget once per 1024 of its own nodes, so
+// the total may overshoot it by up to 1023 nodes per searcher. The first one
+// to find it spent stops them all
 static FORCE_INLINE bool is_timeout(search_ctx_t* ctx, const bool done_depth) {
   if (search_flag_load() == ST_PONDER) {
     return false;
   }
 
   time_control_t* tc = &ctx->time_control;
-  if (!tc->timeout && (done_depth || (ctx->nodes & TIME_CHECK_MASK) == 0)) {
+  if (!tc->timeout && (done_depth || (nodes_load(ctx) & TIME_CHECK_MASK) == 0)) {
     const uint64_t now = now_ms() - ctx->time_control.start_ms;
-    tc->timeout = now >= tc->hard_ms || (done_depth && now >= tc->soft_ms);
+    if (now >= tc->hard_ms) {
+      tc->timeout = true;
+      ctx->stop_reason = STOP_HARD;
+    } else if (tc->max_nodes > 0 && search_nodes() >= tc->max_nodes) {
+      tc->timeout = true;
+      ctx->stop_reason = STOP_NODES;
+      atomic_store_explicit(&helpers_stop, true, memory_order_relaxed);
+    } else if (done_depth && now >= tc->soft_ms) {
+      tc->timeout = true;
+      ctx->stop_reason = STOP_SOFT;
+    }
   }
 
   return tc->timeout;
 }
 
+bool search_init_threads(uint16_t threads) {
+  threads = (threads < 1)             ? 1
+            : (threads > MAX_THREADS) ? MAX_THREADS
+                                      : threads;
+
+  if (searchers) {
+    aligned_free(searchers);
+    searchers = NULL;
+    searchers_len = 0;
+  }
+
+  const size_t bytes = threads * sizeof(search_ctx_t);
+  if (aligned_alloc_64((void**)&searchers, bytes) != 0) {
+    UCI_SEND("info string failed to allocate search threads");
+    searchers = NULL;
+    return false;
+  }
+
+  memset(searchers, 0, bytes);
+  for (uint16_t i = 0; i < threads; i++) {
+    searchers[i].thread_id = i;
+  }
+  searchers_len = threads;
+  return true;
+}
+
+search_ctx_t* search_main(void) { return &searchers[0]; }
+
+void search_clear(void) {
+  for (uint16_t i = 0; i < searchers_len; i++) {
+    hh_clear(&searchers[i].hh);
+    cm_clear(&searchers[i].counter_moves);
+    caph_clear(&searchers[i].caph);
+    for (uint8_t j = 0; j < CONT_HISTORY_PLIES; j++) {
+      ch_clear(&searchers[i].cont_history[j]);
+    }
+  }
+}
+
+// Helpers' counters are read while they are still searching
+uint64_t search_nodes(void) {
+  uint64_t nodes = 0;
+  for (uint16_t i = 0; i < searchers_len; i++) {
+    nodes += nodes_load(&searchers[i]);
+  }
+  return nodes;
+}
+
+void search_set_multi_pv(const uint8_t lines) {
+  multi_pv = (lines < 1)              ? 1
+             : (lines > MAX_MULTI_PV) ? MAX_MULTI_PV
+                                      : lines;
+}
+
+// Everything but the history is reset between searches
+static void prepare_searcher(search_ctx_t* ctx, const board_t* board,
+                             const time_control_t time_control,
+                             const move_list_t* searchmoves) {
+  ctx->board = *board;
+  ctx->root_moves.len = 0;
+  if (searchmoves != NULL) {
+    ctx->root_moves = *searchmoves;
+  }
+  ctx->multi_pv = (ctx->thread_id == 0) ? multi_pv : 1;
+  memset(ctx->stack, 0, sizeof(ctx->stack));
+  for (uint8_t i = 0; i < STACK_OFFSET; i++) {
+    ctx->stack[i].static_eval = -MATE_SCORE;
+  }
+  stack_at(ctx, 0)->pv = ctx->root_pv;
+  ctx->root_pv[0] = 0;
+  ctx->time_control = time_control;
+  atomic_store_explicit(&ctx->nodes, 0, memory_order_relaxed);
+  ctx->seldepth = 0;
+  ctx->completed_depth = 0;
+  ctx->stop_reason = STOP_NONE;
+#ifdef SEARCH_STATS
+  ctx->stats = (search_stats_t){0};
+#endif
+}
+
+static void* helper_search(void* arg) {
+  move_t ponder_move = 0;
+  iterative_deepening((search_ctx_t*)arg, &ponder_move, helpers_depth);
+  return NULL;
+}
+
+// A helper's move is preferred when it completed a deeper iteration with a
+// better score
+static const search_ctx_t* pick_searcher(const uint16_t len) {
+  const search_ctx_t* best = &searchers[0];
+  if (best->multi_pv > 1) {
+    return best;  // Helpers only know the best line
+  }
+  for (uint16_t i = 1; i < len; i++) {
+    const search_ctx_t* helper = &searchers[i];
+    if (helper->completed_depth > best->completed_depth &&
+        (best->completed_depth == 0 ||
+         helper->iterations[helper->completed_depth].score >
+             best->iterations[best->completed_depth].score)) {
+      best = helper;
+    }
+  }
+  return best;
+}
+
+move_t search_run(const board_t* board, const time_control_t time_control,
+                  const uint8_t depth, const move_list_t* searchmoves,
+                  move_t* ponder_move) {
+  assert(searchers != NULL);
+
+  // Helpers never look at the clock, the main searcher stops them. They do
+  // check the node budget so a starved main thread can't stretch it
+  const time_control_t helper_time_control = {
+      false, time_control.start_ms, UINT64_MAX, UINT64_MAX,
+      time_control.max_nodes};
+  prepare_searcher(&searchers[0], board, time_control, searchmoves);
+  for (uint16_t i = 1; i < searchers_len; i++) {
+    prepare_searcher(&searchers[i], board, helper_time_control, searchmoves);
+  }
+
+  atomic_store_explicit(&helpers_stop, false, memory_order_relaxed);
+  helpers_depth = depth;
+
+  pthread_t helpers[MAX_THREADS];
+  uint16_t started = 1;
+  for (; started < searchers_len; started++) {
+    if (pthread_create(&helpers[started], NULL, helper_search,
+                       &searchers[started]) != 0) {
+      UCI_SEND("info string error starting helper thread");
+      break;
+    }
+  }
+
+  move_t best_move = iterative_deepening(&searchers[0], ponder_move, depth);
+
+  atomic_store_explicit(&helpers_stop, true, memory_order_relaxed);
+  for (uint16_t i = 1; i < started; i++) {
+    pthread_join(helpers[i], NULL);
+  }
+
+  const search_ctx_t* best = pick_searcher(started);
+  if (best != &searchers[0]) {
+    const iteration_t* iteration = &best->iterations[best->completed_depth];
+    best_move = iteration->best_move;
+    *ponder_move = iteration->ponder_move;
+  }
+
+  return best_move;
+}
+
+// Engine must not send bestmove until `ponderhit` or `stop`, nor before
+// `stop` on an infinite search
+static void wait_for_bestmove(const bool infinite) {
+  pthread_mutex_lock(&flag_lock);
+  while (search_flag_load() == ST_PONDER ||
+         (infinite && search_flag_load() != ST_EXIT)) {
+    pthread_cond_wait(&flag_changed, &flag_lock);
+  }
+  pthread_mutex_unlock(&flag_lock);
+}
+
 void* start_search(void* params) {
   assert(params != NULL);
   const uci_go_params_t p = *(uci_go_params_t*)params;
 
-  search_ctx_t ctx = {
-      .board = p.engine->board,
-      .pv = (pv_table_t){{{0}}, {0}},
-      .time_control = p.time_control,
-      .nodes = 0,
-      .killers = {{0}},
-      .seldepth = 0,
-  };
-
   move_t ponder_move = 0;
-  const move_t best_move = iterative_deepening(&ctx, &ponder_move, p.depth);
+  const move_t best_move = search_run(&p.engine->board, p.time_control,
+                                     p.depth, &p.searchmoves, &ponder_move);
+  const search_ctx_t* ctx = search_main();
+#ifdef SEARCH_STATS
+  last_search_stats = ctx->stats;
+#endif
 
   char best_move_uci[6] = {0};
   char ponder_move_uci[6] = {0};
@@ -82,11 +332,9 @@ void* start_search(void* params) {
     move_to_uci(ponder_move, ponder_move_uci);
   }
 
-  // Engine must not send bestmove until `ponderhit` or `stop`
-  while (search_flag_load() == ST_PONDER) {
-    sched_yield();
-  }
+  wait_for_bestmove(p.infinite);
 
+  const uint64_t used_ms = now_ms() - ctx->time_control.start_ms;
   printf("bestmove %s", best_move_uci);
   if (ponder_move) {
     printf(" ponder %s", ponder_move_uci);
@@ -94,56 +342,279 @@ void* start_search(void* params) {
   putchar('\n');
   fflush(stdout);
 
+  telemetry_record(&(telemetry_t){
+      p.clock_ms, p.inc_ms, p.movestogo, ctx->time_control.soft_ms,
+      ctx->time_control.hard_ms, used_ms, search_nodes(),
+      ctx->completed_depth, ctx->seldepth, ctx->stop_reason});
+
   tt_update();
   search_flag_store(ST_EXIT);
 
   return NULL;
 }
 
-static void update_heuristics(search_ctx_t* __restrict ctx, const uint8_t ply,
+void search_flag_store(const search_flag_t value) {
+  pthread_mutex_lock(&flag_lock);
+  atomic_store_explicit(&SEARCH_FLAG, value, memory_order_release);
+  pthread_cond_broadcast(&flag_changed);
+  pthread_mutex_unlock(&flag_lock);
+}
+
+void search_stats_add(search_stats_t* total, const search_stats_t* stats) {
+  total->main_nodes += stats->main_nodes;
+  total->qs_nodes += stats->qs_nodes;
+  total->tt_probes += stats->tt_probes;
+  total->tt_hits += stats->tt_hits;
+  for (uint8_t i = 0; i < 4; i++) {
+    total->tt_cutoffs[i] += stats->tt_cutoffs[i];
+  }
+  total->null_tries += stats->null_tries;
+  total->null_cutoffs += stats->null_cutoffs;
+  total->beta_cutoffs += stats->beta_cutoffs;
+  total->first_move_cutoffs += stats->first_move_cutoffs;
+  total->cutoff_index_sum += stats->cutoff_index_sum;
+  for (uint8_t i = 0; i < MAX_PLY; i++) {
+    total->depth_nodes[i] += stats->depth_nodes[i];
+  }
+  total->depth = (stats->depth > total->depth) ? stats->depth : total->depth;
+}
+
+static void update_quiet_history(search_ctx_t* __restrict ctx,
+                                 const search_stack_t* __restrict ss,
+                                 const move_t move, const int bonus) {
+  hh_update(&ctx->hh, move, bonus, &ctx->board);
+  for (uint8_t i = 0; i < CONT_HISTORY_PLIES; i++) {
+    const search_stack_t* prev = ss - 1 - i;
+    if (prev->move) {
+      ch_update(&ctx->cont_history[i], prev->piece, get_to(prev->move), move,
+                bonus, &ctx->board);
+    }
+  }
+}
+
+// `quiets_tried` are the quiet moves searched before the cutoff move
+static void update_heuristics(search_ctx_t* __restrict ctx,
+                              search_stack_t* __restrict ss,
                               const uint8_t depth, const move_t move,
-                              const uint8_t idx,
-                              const move_list_t* __restrict move_list,
+                              const move_list_t* __restrict quiets_tried,
                               const move_t hash_move) {
-  if (ctx->killers[ply][0] != move) {
-    ctx->killers[ply][1] = ctx->killers[ply][0];
-    ctx->killers[ply][0] = move;
+  if (ss->killers[0] != move) {
+    ss->killers[1] = ss->killers[0];
+    ss->killers[0] = move;
+  }
+
+  const search_stack_t* prev = ss - 1;
+  if (prev->move) {
+    cm_update(&ctx->counter_moves, prev->piece, get_to(prev->move), move,
+              &ctx->board);
   }
 
   const int bonus = depth * depth;
-  hh_update(move, bonus, &ctx->board);
+  update_quiet_history(ctx, ss, move, bonus);
 
   // Apply history maluses
-  for (uint8_t i = 0; i < idx; i++) {
-    const move_t quiet_move = move_list->moves[i];
-    if (is_quiet(quiet_move) && quiet_move != ctx->killers[ply][1] &&
-        quiet_move != hash_move) {
-      hh_update(quiet_move, -bonus, &ctx->board);
+  for (uint8_t i = 0; i < quiets_tried->len; i++) {
+    const move_t quiet_move = quiets_tried->moves[i];
+    if (quiet_move != ss->killers[1] && quiet_move != hash_move) {
+      update_quiet_history(ctx, ss, quiet_move, -bonus);
+    }
+  }
+}
+
+// Rewards a capture that caused a cutoff and penalizes the captures searched
+// before it, whatever the cutoff move was
+static void update_capture_history(
+    search_ctx_t* __restrict ctx, const uint8_t depth, const move_t move,
+    const move_list_t* __restrict captures_tried, const move_t hash_move) {
+  const int bonus = depth * depth;
+  if (get_flags(move) & FLAG_CAPTURE) {
+    caph_update(&ctx->caph, move, bonus, &ctx->board);
+  }
+
+  for (uint8_t i = 0; i < captures_tried->len; i++) {
+    const move_t capture = captures_tried->moves[i];
+    if (capture != hash_move) {
+      caph_update(&ctx->caph, capture, -bonus, &ctx->board);
+    }
+  }
+}
+
+static FORCE_INLINE bool is_root_move(const search_ctx_t* ctx,
+                                      const move_t move) {
+  if (ctx->root_moves.len == 0) {
+    return true;
+  }
+  for (uint8_t i = 0; i < ctx->root_moves.len; i++) {
+    if (ctx->root_moves.moves[i] == move) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint8_t count_root_moves(search_ctx_t* ctx) {
+  board_t* board = &ctx->board;
+  const move_list_t move_list = gen_color_moves(board);
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < move_list.len; i++) {
+    const move_t move = move_list.moves[i];
+    const undo_t undo = do_move(move, board);
+    count += was_legal(move, board) && is_root_move(ctx, move);
+    undo_move(undo, move, board);
+  }
+
+  return count;
+}
+
+// The root skips the moves outside `searchmoves` and those of the lines
+// found earlier in this iteration
+static FORCE_INLINE bool is_root_excluded(const search_ctx_t* ctx,
+                                          const move_t move) {
+  if (!is_root_move(ctx, move)) {
+    return true;
+  }
+  for (uint8_t i = 0; i < ctx->pv_index; i++) {
+    if (ctx->lines[i].moves[0] == move) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A failed low root keeps the moves of the line's last iteration
+static void save_line(search_ctx_t* ctx, const int score, const uint8_t bound) {
+  pv_line_t* line = &ctx->lines[ctx->pv_index];
+  line->score = score;
+  line->bound = bound;
+  if (ctx->root_pv[0]) {
+    line->len = 0;
+    for (const move_t* move = ctx->root_pv; *move; move++) {
+      line->moves[line->len++] = *move;
     }
   }
 }
 
+// Lines are reported best first, the search order may differ slightly
+static void sort_lines(search_ctx_t* ctx) {
+  for (uint8_t i = 1; i < ctx->lines_len; i++) {
+    const pv_line_t line = ctx->lines[i];
+    uint8_t j = i;
+    for (; j > 0 && ctx->lines[j - 1].score < line.score; j--) {
+      ctx->lines[j] = ctx->lines[j - 1];
+    }
+    ctx->lines[j] = line;
+  }
+}
+
 move_t iterative_deepening(search_ctx_t* ctx, move_t* ponder_move,
                            const uint8_t depth) {
   move_t best_move = 0;
+  const uint8_t legal_moves = count_root_moves(ctx);
+
+  ctx->lines_len = (ctx->multi_pv < legal_moves) ? ctx->multi_pv : legal_moves;
+  ctx->lines_len = (ctx->lines_len > 0) ? ctx->lines_len : 1;
+  memset(ctx->lines, 0, ctx->lines_len * sizeof(pv_line_t));
 
   for (uint8_t curr_depth = 1; curr_depth <= depth; curr_depth++) {
-    const int score = alpha_beta(ctx, curr_depth, 0, -MATE_SCORE, MATE_SCORE);
+    if (skip_depth(ctx, curr_depth)) {
+      continue;
+    }
+#ifdef SEARCH_STATS
+    const uint64_t iteration_start_nodes = nodes_load(ctx);
+#endif
+    int score = 0;
+
+    // Each line searches the root without the moves of the lines before it
+    for (ctx->pv_index = 0; ctx->pv_index < ctx->lines_len; ctx->pv_index++) {
+      // Aspiration window around the line's last score, widened on the
+      // failing side until the score falls inside
+      int alpha = -MATE_SCORE, beta = MATE_SCORE;
+      int delta = ASPIRATION_WINDOW;
+      const int last_score = ctx->lines[ctx->pv_index].score;
+      if (curr_depth >= ASPIRATION_MIN_DEPTH && ctx->completed_depth > 0 &&
+          abs(last_score) < MATE_THRESHOLD) {
+        alpha = (last_score - delta > -MATE_SCORE) ? last_score - delta
+                                                   : -MATE_SCORE;
+        beta = (last_score + delta < MATE_SCORE) ? last_score + delta
+                                                 : MATE_SCORE;
+      }
+
+      while (true) {
+        score = alpha_beta(ctx, curr_depth, 0, alpha, beta);
+        if (is_stopped() || ctx->time_control.timeout) {
+          break;
+        }
+
+        uint8_t bound;
+        if (score <= alpha && alpha > -MATE_SCORE) {
+          bound = BOUND_UPPER;
+          alpha = (score - delta > -MATE_SCORE) ? score - delta : -MATE_SCORE;
+        } else if (score >= beta && beta < MATE_SCORE) {
+          bound = BOUND_LOWER;
+          beta = (score + delta < MATE_SCORE) ? score + delta : MATE_SCORE;
+        } else {
+          break;
+        }
+
+        if (ctx->thread_id == 0) {
+          save_line(ctx, score, bound);
+          send_info_depth(ctx, curr_depth, ctx->pv_index);
+        }
+        delta += delta / 2;
+      }
 
-    if (search_flag_load() == ST_EXIT || is_timeout(ctx, true)) {
-      if (curr_depth <= 1) {
-        best_move = ctx->pv.table[0][0];
-        send_info_depth(ctx, curr_depth, score);
+      if (is_stopped() || ctx->time_control.timeout) {
+        break;
+      }
+      save_line(ctx, score, BOUND_EXACT);
+    }
+
+    if (is_stopped() || is_timeout(ctx, true)) {
+      if (!ctx->time_control.timeout) {
+        // A helper may have been the one to spend the node budget
+        const uint64_t max_nodes = ctx->time_control.max_nodes;
+        ctx->stop_reason = (max_nodes > 0 && search_nodes() >= max_nodes)
+                               ? STOP_NODES
+                               : STOP_USER;
+      }
+      if (ctx->completed_depth == 0) {
+        // Later lines excluded the best move, which the first one found
+        if (ctx->pv_index == 0) {
+          save_line(ctx, score, BOUND_EXACT);
+        }
+        best_move = ctx->lines[0].moves[0];
+        if (ctx->thread_id == 0) {
+          send_info_depth(ctx, curr_depth, 0);
+        }
       }
       break;
     }
 
-    best_move = ctx->pv.table[0][0];
-    *ponder_move = 0;
-    if (ctx->pv.len[0] >= 2) {
-      *ponder_move = ctx->pv.table[0][1];
+    sort_lines(ctx);
+    const pv_line_t* best = &ctx->lines[0];
+    best_move = best->moves[0];
+    *ponder_move = (best->len >= 2) ? best->moves[1] : 0;
+    ctx->iterations[curr_depth] =
+        (iteration_t){best_move, *ponder_move, best->score, search_nodes(),
+                      now_ms() - ctx->time_control.start_ms + 1};
+    ctx->completed_depth = curr_depth;
+#ifdef SEARCH_STATS
+    ctx->stats.depth_nodes[curr_depth] = nodes_load(ctx) - iteration_start_nodes;
+    ctx->stats.depth = curr_depth;
+#endif
+    if (ctx->thread_id == 0) {
+      for (uint8_t i = 0; i < ctx->lines_len; i++) {
+        send_info_depth(ctx, curr_depth, i);
+      }
+#ifdef SEARCH_STATS
+      send_info_stats(&ctx->stats);
+#endif
     }
-    send_info_depth(ctx, curr_depth, score);
+  }
+
+  if (ctx->stop_reason == STOP_NONE) {
+    ctx->stop_reason = STOP_DEPTH;
   }
 
   return best_move;
@@ -151,40 +622,51 @@ move_t iterative_deepening(search_ctx_t* ctx, move_t* ponder_move,
 
 int alpha_beta(search_ctx_t* ctx, uint8_t depth, const uint8_t ply, int alpha,
                const int beta) {
-  ctx->pv.len[ply] = 0;
+  search_stack_t* ss = stack_at(ctx, ply);
+  if (ss->pv) {
+    ss->pv[0] = 0;
+  }
   if (depth == 0) {
-    return quiescence(ctx, ply, alpha, beta);
+    return quiescence(ctx, ply, alpha, beta, true);
   }
 
   const bool is_pv = alpha != beta - 1;
   const bool is_root = ply == 0;
+  const move_t excluded = ss->excluded;
   board_t* board = &ctx->board;
+  move_t child_pv[MAX_PLY + 1];
+  (ss + 1)->pv = NULL;
 
   check_ponderhit(ctx);
 
-  ctx->nodes++;
+  nodes_inc(ctx);
   ctx->seldepth = (ply > ctx->seldepth) ? ply : ctx->seldepth;
+  STATS_INC(ctx, main_nodes);
 
   tt_prefetch(board->zobrist);
   const tt_entry_t tt_entry = tt_probe(board->zobrist);
   int tt_score = -MATE_SCORE;
+  STATS_INC(ctx, tt_probes);
+  STATS_ADD(ctx, tt_hits, tt_entry.bound != BOUND_NONE);
 
   if (!is_root) {
     if (is_draw(board)) {
       return 0;
     }
 
-    if (tt_entry.bound != BOUND_NONE && tt_entry.depth >= depth) {
+    // The entry belongs to the full node, so a search without the excluded
+    // move can't take its cutoffs
+    if (!excluded && tt_entry.bound != BOUND_NONE && tt_entry.depth >= depth) {
       tt_score = decode_mate(tt_entry.score, ply);
       if (tt_entry.bound == BOUND_EXACT ||
           (!is_pv && tt_entry.bound == BOUND_LOWER && tt_score >= beta) ||
           (!is_pv && tt_entry.bound == BOUND_UPPER && tt_score <= alpha)) {
+        STATS_INC(ctx, tt_cutoffs[tt_entry.bound]);
         return tt_score;
       }
     }
 
-    if (ply >= MAX_PLY || is_timeout(ctx, false) ||
-        search_flag_load() == ST_EXIT) {
+    if (ply >= MAX_PLY || is_timeout(ctx, false) || is_stopped()) {
       return static_eval(board);
     }
   }
@@ -194,15 +676,53 @@ int alpha_beta(search_ctx_t* ctx, uint8_t depth, const uint8_t ply, int alpha,
     depth++;
   }
 
+  // Internal iterative reductions: without a TT move the ordering is poor
+  // and the next iteration will come back with one, so search shallower
+  if (!is_root && depth >= IIR_MIN_DEPTH && !tt_entry.best_move) {
+    depth--;
+  }
+
+  const int eval = checked ? -MATE_SCORE : static_eval(board);
+  const bool can_prune = !is_pv && !checked;
+  ss->static_eval = eval;
+
+  // Improving: the eval rose since our last move. Reverse futility then
+  // trusts the eval with a smaller margin, while late move pruning and
+  // reductions cut harder when not improving. A check two plies ago counts
+  // as improving
+  const bool improving = eval > (ss - 2)->static_eval;
+
+  // Reverse futility pruning: the eval is so far above beta that a quiet
+  // search won't bring it back
+  if (can_prune && !is_root && depth <= TABLE_DEPTH(RFP_MARGIN) &&
+      abs(beta) < MATE_THRESHOLD &&
+      eval - RFP_MARGIN[depth - improving] >= beta) {
+    return eval;
+  }
+
+  // Razoring: hopeless positions near the leaves only get a quiescence search
+  if (can_prune && !is_root && !excluded && depth <= TABLE_DEPTH(RAZOR_MARGIN) &&
+      abs(alpha) < MATE_THRESHOLD && eval + RAZOR_MARGIN[depth] <= alpha) {
+    const int score = quiescence(ctx, ply, alpha, beta, true);
+    if (depth == 1 || score <= alpha) {
+      return score;
+    }
+  }
+
+  const bool futile = can_prune && depth <= TABLE_DEPTH(FUTILITY_MARGIN) &&
+                      abs(alpha) < MATE_THRESHOLD &&
+                      eval + FUTILITY_MARGIN[depth] <= alpha;
+
   // Null move pruning
   const bitboard_t non_pawn_material =
       board->occupancies[board->side_to_move] &
       ~(board->bitboards[PT_PAWN] | board->bitboards[PT_KING]);
-  if (depth >= 3 && !is_root && !is_pv && !checked &&
+  if (depth >= 3 && !is_root && !is_pv && !checked && !excluded &&
       (tt_entry.bound == BOUND_NONE || tt_entry.bound != BOUND_UPPER ||
        tt_score >= beta) &&
       non_pawn_material) {
     const square_t ep_target = do_null_move(board);
+    ss->move = 0;
 
     const uint8_t R = depth > 6 ? 4 : 3;
     int next_depth = (int)depth - 1 - R;
@@ -213,28 +733,125 @@ int alpha_beta(search_ctx_t* ctx, uint8_t depth, const uint8_t ply, int alpha,
     const int score = -alpha_beta(ctx, next_depth, ply + 1, -beta, -beta + 1);
 
     undo_null_move(ep_target, board);
+    STATS_INC(ctx, null_tries);
 
     // Don't return mates
     if (score >= beta) {
+      STATS_INC(ctx, null_cutoffs);
       return (score >= MATE_THRESHOLD) ? beta : score;
     }
   }
 
+  // ProbCut: a capture beating a raised beta at reduced depth will most
+  // likely beat beta at full depth. Captures first have to clear it by SEE,
+  // then in a quiescence search, before the reduced search
+  const int probcut_beta = beta + PROBCUT_MARGIN;
+  if (can_prune && !excluded && depth >= PROBCUT_MIN_DEPTH &&
+      abs(beta) < MATE_THRESHOLD &&
+      !(tt_entry.bound != BOUND_NONE &&
+        tt_entry.depth + PROBCUT_REDUCTION > depth &&
+        decode_mate(tt_entry.score, ply) < probcut_beta)) {
+    move_list_t captures = gen_captures_only(board);
+    int capture_scores[MAX_MOVES] = {0};
+    score_list(ctx, &captures, &tt_entry, ply, capture_scores);
+
+    for (uint8_t i = 0; i < captures.len; i++) {
+      next_move(&captures, capture_scores, i);
+      const move_t move = captures.moves[i];
+      if (!see_ge(board, move, probcut_beta - eval)) {
+        continue;
+      }
+
+      const undo_t undo = do_move(move, board);
+      if (!was_legal(move, board)) {
+        undo_move(undo, move, board);
+        continue;
+      }
+
+      ss->move = move;
+      ss->piece = board->mailbox[get_to(move)];
+      int score =
+          -quiescence(ctx, ply + 1, -probcut_beta, -probcut_beta + 1, false);
+      if (score >= probcut_beta) {
+        score = -alpha_beta(ctx, depth - PROBCUT_REDUCTION, ply + 1,
+                            -probcut_beta, -probcut_beta + 1);
+      }
+      undo_move(undo, move, board);
+
+      if (is_stopped()) {
+        return eval;
+      }
+      if (score >= probcut_beta) {
+        tt_store(board->zobrist, move, score, depth - PROBCUT_REDUCTION + 1,
+                 ply, BOUND_LOWER);
+        return score;
+      }
+    }
+  }
+
+  // Singular extensions: search every move but the TT move at reduced depth
+  // against a beta below the TT score. If they all fail low the TT move is
+  // the only good one and gets extended. If even the reduced search beats
+  // beta, several moves do and the node is cut (multi-cut)
+  move_t singular_move = 0;
+  if (!is_root && !excluded && depth >= SINGULAR_MIN_DEPTH &&
+      tt_entry.best_move &&
+      (tt_entry.bound == BOUND_LOWER || tt_entry.bound == BOUND_EXACT) &&
+      tt_entry.depth + SINGULAR_TT_DEPTH >= depth &&
+      abs(decode_mate(tt_entry.score, ply)) < MATE_THRESHOLD) {
+    const int singular_beta =
+        decode_mate(tt_entry.score, ply) - SINGULAR_MARGIN * depth;
+
+    // The search shares this ply's stack entry, but not its PV
+    move_t* pv = ss->pv;
+    ss->pv = NULL;
+    ss->excluded = tt_entry.best_move;
+    const int score = alpha_beta(ctx, (depth - 1) / 2, ply, singular_beta - 1,
+                                 singular_beta);
+    ss->excluded = 0;
+    ss->pv = pv;
+
+    if (score < singular_beta) {
+      singular_move = tt_entry.best_move;
+    } else if (singular_beta >= beta) {
+      return singular_beta;
+    }
+  }
+
   const int alpha_original = alpha;
   move_list_t move_list = gen_color_moves(board);
   int scores[MAX_MOVES] = {0};
   score_list(ctx, &move_list, &tt_entry, ply, scores);
 
   const int max_mate = MATE_SCORE - ply;
-  bool found_pv = false;
   move_t best_move = 0;
   int max = -MATE_SCORE;
   uint8_t currmovenumber = 0;
   uint64_t last_currmove = is_root ? now_ms() : 0;
+  (ss + 1)->pv = is_pv ? child_pv : NULL;
+  // Moves actually searched, the only ones the history maluses apply to
+  move_list_t quiets_tried, captures_tried;
+  quiets_tried.len = captures_tried.len = 0;
 
   for (uint8_t i = 0; i < move_list.len; i++) {
     next_move(&move_list, scores, i);
     const move_t move = move_list.moves[i];
+    if (move == excluded || (is_root && is_root_excluded(ctx, move))) {
+      continue;
+    }
+
+    const bool quiet = is_quiet(move);
+    const bool killer = move == ss->killers[0] || move == ss->killers[1];
+    const int history = quiet ? quiet_history(ctx, move, ply) : 0;
+
+    // SEE pruning: near the leaves, skip moves that lose too much material
+    // once a move has been searched
+    const bool see_losing =
+        can_prune && depth <= SEE_PRUNE_DEPTH && max > -MATE_THRESHOLD &&
+        !see_ge(board, move,
+                quiet ? -SEE_QUIET_MARGIN * depth
+                      : -SEE_CAPTURE_MARGIN * depth * depth);
+
     const undo_t undo = do_move(move, board);
     if (!was_legal(move, board)) {
       undo_move(undo, move, board);
@@ -242,19 +859,63 @@ int alpha_beta(search_ctx_t* ctx, uint8_t depth, const uint8_t ply, int alpha,
     }
 
     currmovenumber++;
+
+    // Futility and late move pruning of quiet moves, once a move has been
+    // searched so mates and stalemates are still detected
+    const bool gives_check = in_check(board);
+    if (quiet && !gives_check && !killer && max > -MATE_THRESHOLD &&
+        (futile ||
+         (can_prune && depth <= TABLE_DEPTH(LMP_MOVES) &&
+          currmovenumber > LMP_MOVES[depth] / (2 - improving)))) {
+      undo_move(undo, move, board);
+      continue;
+    }
+    if (see_losing && !gives_check) {
+      undo_move(undo, move, board);
+      continue;
+    }
+
     uint64_t now;
-    if (is_root && (now = now_ms()) - last_currmove >= 1000) {
+    if (is_root && ctx->thread_id == 0 &&
+        (now = now_ms()) - last_currmove >= 1000) {
       last_currmove = now;
       send_info_currmove(move, currmovenumber);
     }
 
-    int score;
-    if (!found_pv) {
-      score = -alpha_beta(ctx, depth - 1, ply + 1, -beta, -alpha);
+    // Late move reductions: quiet moves ordered late are searched shallower
+    // first, and again at full depth only if they beat alpha
+    int reduction = 0;
+    if (depth >= LMR_MIN_DEPTH && currmovenumber > LMR_MIN_MOVES && quiet) {
+      const uint8_t lmr_depth = (depth < LMR_LEN) ? depth : LMR_LEN - 1;
+      const uint8_t lmr_move =
+          (currmovenumber < LMR_LEN) ? currmovenumber : LMR_LEN - 1;
+      reduction = lmr_table[lmr_depth][lmr_move];
+      reduction += !improving;
+      reduction -= is_pv + checked + gives_check + killer;
+      reduction -= history / LMR_HISTORY_DIV;
+      reduction = (reduction < 0)           ? 0
+                  : (reduction > depth - 2) ? depth - 2
+                                            : reduction;
+    }
+
+    const uint8_t new_depth =
+        (move == singular_move && depth < MAX_PLY - 1) ? depth : depth - 1;
+
+    ss->move = move;
+    ss->piece = board->mailbox[get_to(move)];
+    int score = -MATE_SCORE;
+    if (currmovenumber == 1) {
+      score = -alpha_beta(ctx, new_depth, ply + 1, -beta, -alpha);
     } else {
-      score = -alpha_beta(ctx, depth - 1, ply + 1, -alpha - 1, -alpha);
+      if (reduction > 0) {
+        score = -alpha_beta(ctx, new_depth - reduction, ply + 1, -alpha - 1,
+                            -alpha);
+      }
+      if (reduction == 0 || score > alpha) {
+        score = -alpha_beta(ctx, new_depth, ply + 1, -alpha - 1, -alpha);
+      }
       if (score > alpha && score < beta) {
-        score = -alpha_beta(ctx, depth - 1, ply + 1, -beta, -alpha);
+        score = -alpha_beta(ctx, new_depth, ply + 1, -beta, -alpha);
       }
     }
 
@@ -264,19 +925,30 @@ int alpha_beta(search_ctx_t* ctx, uint8_t depth, const uint8_t ply, int alpha,
       max = score;
       best_move = move;
       if (score > alpha) {
-        pv_update(&ctx->pv, ply, move);
-        found_pv = true;
+        if (ss->pv) {
+          pv_update(ss->pv, move, (ss + 1)->pv);
+        }
         alpha = score;
       }
     }
     if (alpha >= beta) {
+      STATS_INC(ctx, beta_cutoffs);
+      STATS_ADD(ctx, first_move_cutoffs, currmovenumber == 1);
+      STATS_ADD(ctx, cutoff_index_sum, currmovenumber);
       if (is_quiet(move)) {
-        update_heuristics(ctx, ply, depth, move, i, &move_list,
+        update_heuristics(ctx, ss, depth, move, &quiets_tried,
                           tt_entry.best_move);
       }
+      update_capture_history(ctx, depth, move, &captures_tried,
+                             tt_entry.best_move);
       break;
     }
-    if (search_flag_load() == ST_EXIT || is_timeout(ctx, false)) {
+    if (quiet) {
+      push_move(&quiets_tried, move);
+    } else if (get_flags(move) & FLAG_CAPTURE) {
+      push_move(&captures_tried, move);
+    }
+    if (is_stopped() || is_timeout(ctx, false)) {
       return max;
     }
   }
@@ -291,12 +963,19 @@ int alpha_beta(search_ctx_t* ctx, uint8_t depth, const uint8_t ply, int alpha,
       bound = BOUND_EXACT;
     }
 
-    tt_store(board->zobrist, best_move, max, depth, ply, bound);
+    // Later MultiPV lines and `searchmoves` only searched part of the root
+    if (!excluded &&
+        !(is_root && (ctx->pv_index > 0 || ctx->root_moves.len > 0))) {
+      tt_store(board->zobrist, best_move, max, depth, ply, bound);
+    }
 
     return max;
   }
 
-  if (checked) {
+  // Without its excluded move the node isn't mate nor stalemate
+  if (excluded) {
+    return alpha;
+  } else if (checked) {
     return -max_mate;
   } else {
     return 0;
@@ -304,46 +983,114 @@ int alpha_beta(search_ctx_t* ctx, uint8_t depth, const uint8_t ply, int alpha,
 }
 
 int quiescence(search_ctx_t* ctx, const uint8_t ply, int alpha,
-               const int beta) {
+               const int beta, const bool checks) {
   check_ponderhit(ctx);
 
-  ctx->nodes++;
+  nodes_inc(ctx);
   ctx->seldepth = (ply > ctx->seldepth) ? ply : ctx->seldepth;
+  STATS_INC(ctx, qs_nodes);
 
+  const bool is_pv = alpha != beta - 1;
   board_t* board = &ctx->board;
-  int max = static_eval(board);
 
-  if (ply >= MAX_PLY || is_timeout(ctx, false) ||
-      search_flag_load() == ST_EXIT) {
-    return max;
+  tt_prefetch(board->zobrist);
+  const tt_entry_t tt_entry = tt_probe(board->zobrist);
+  STATS_INC(ctx, tt_probes);
+  STATS_ADD(ctx, tt_hits, tt_entry.bound != BOUND_NONE);
+
+  // Every entry is at least as deep as a quiescence search
+  if (tt_entry.bound != BOUND_NONE) {
+    const int tt_score = decode_mate(tt_entry.score, ply);
+    if (tt_entry.bound == BOUND_EXACT ||
+        (!is_pv && tt_entry.bound == BOUND_LOWER && tt_score >= beta) ||
+        (!is_pv && tt_entry.bound == BOUND_UPPER && tt_score <= alpha)) {
+      STATS_INC(ctx, tt_cutoffs[tt_entry.bound]);
+      return tt_score;
+    }
   }
 
-  // Stand pat
-  if (max >= beta) {
+  int max = static_eval(board);
+
+  if (ply >= MAX_PLY || is_timeout(ctx, false) || is_stopped()) {
     return max;
   }
-  if (max > alpha) {
-    alpha = max;
+
+  const bool checked = in_check(board);
+  const int alpha_original = alpha;
+  move_list_t move_list;
+
+  if (checked) {
+    // No standing pat in check: every evasion is searched and having none
+    // is mate
+    max = -MATE_SCORE + ply;
+    move_list = gen_color_moves(board);
+  } else {
+    // Stand pat
+    if (max >= beta) {
+      return max;
+    }
+    if (max > alpha) {
+      alpha = max;
+    }
+
+    // Delta pruning: not even winning a queen would raise alpha
+    const bitboard_t promoting =
+        board->bitboards[PT_PAWN] & board->occupancies[board->side_to_move] &
+        ((board->side_to_move == CLR_WHITE) ? R7 : R2);
+    if (!promoting && max + SEE_VALUE[PT_QUEEN] + DELTA_MARGIN <= alpha) {
+      return max;
+    }
+
+    move_list = gen_captures_only(board);
+    if (checks) {
+      gen_quiet_checks(board, &move_list);
+    }
   }
 
-  move_list_t move_list = gen_captures_only(board);
   int scores[MAX_MOVES] = {0};
-  score_list(ctx, &move_list, NULL, ply, scores);
+  score_list(ctx, &move_list, &tt_entry, ply, scores);
+  move_t best_move = 0;
 
   for (uint8_t i = 0; i < move_list.len; i++) {
     next_move(&move_list, scores, i);
     const move_t move = move_list.moves[i];
+    const uint8_t flags = get_flags(move);
+
+    if (!checked && (flags & FLAG_CAPTURE)) {
+      // Captures losing material by SEE
+      if (scores[i] < GOOD_CAPTURE_SCORE) {
+        continue;
+      }
+
+      // Delta pruning: the captured piece can't bring the eval up to alpha
+      if (!(flags & FLAG_PROMOTION)) {
+        const piece_t victim =
+            (flags == FLAG_EP) ? PT_PAWN : board->mailbox[get_to(move)];
+        if (max + SEE_VALUE[victim] + DELTA_MARGIN <= alpha) {
+          continue;
+        }
+      }
+    } else if (!checked && !see_ge(board, move, 0)) {
+      // Quiet checks hanging the piece
+      continue;
+    }
+
     const undo_t undo = do_move(move, board);
     if (!was_legal(move, board)) {
       undo_move(undo, move, board);
       continue;
     }
 
-    const int score = -quiescence(ctx, ply + 1, -beta, -alpha);
+    // The children order their evasions and checks after this move
+    search_stack_t* ss = stack_at(ctx, ply);
+    ss->move = move;
+    ss->piece = board->mailbox[get_to(move)];
+    const int score = -quiescence(ctx, ply + 1, -beta, -alpha, false);
     undo_move(undo, move, board);
 
     if (score > max) {
       max = score;
+      best_move = move;
       if (score > alpha) {
         alpha = score;
       }
@@ -351,10 +1098,29 @@ int quiescence(search_ctx_t* ctx, const uint8_t ply, int alpha,
     if (alpha >= beta) {
       break;
     }
-    if (search_flag_load() == ST_EXIT || is_timeout(ctx, false)) {
+    if (is_stopped() || is_timeout(ctx, false)) {
       return max;
     }
   }
 
+  // A cutoff may come from a child that returned because the search ended
+  if (is_stopped() || ctx->time_control.timeout) {
+    return max;
+  }
+
+  // Don't overwrite the result of a main search node
+  if (tt_entry.bound == BOUND_NONE || tt_entry.depth == 0) {
+    uint8_t bound;
+    if (max <= alpha_original) {
+      bound = BOUND_UPPER;
+    } else if (max >= beta) {
+      bound = BOUND_LOWER;
+    } else {
+      bound = BOUND_EXACT;
+    }
+
+    tt_store(board->zobrist, best_move, max, 0, ply, bound);
+  }
+
   return max;
 }
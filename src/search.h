@@ -5,33 +5,111 @@
 
 #include "board.h"
 #include "defs.h"
+#include "history.h"
 
 #define MAX_PLY 128
 #define MATE_SCORE 32000
 #define MATE_THRESHOLD (MATE_SCORE - (MAX_PLY * 2))
+#define MAX_THREADS 256
+#define MAX_MULTI_PV 64
 
+// A root line of the MultiPV search, as of the last iteration that reached it
 typedef struct {
-  move_t table[MAX_PLY][MAX_PLY];
-  uint8_t len[MAX_PLY];
-} pv_table_t;
+  move_t moves[MAX_PLY];
+  uint8_t len;
+  uint8_t bound;
+  int score;
+} pv_line_t;
 
 typedef struct {
   bool timeout;
   uint64_t start_ms;
   uint64_t soft_ms, hard_ms;
+  uint64_t max_nodes;  // Node budget over all searchers, 0 for none
 } time_control_t;
 
-typedef move_t killers_t[MAX_PLY][2];
+// Sentinel entries below ply 0 for the stack lookbacks
+#define STACK_OFFSET 2
+// Earlier moves of the line the continuation histories follow up on
+#define CONT_HISTORY_PLIES 2
+
+// Search state of one ply of the current line
+typedef struct {
+  move_t* pv;        // Zero-terminated PV of the node, NULL off the PV
+  move_t move;       // Move being searched, 0 for the null move
+  piece_t piece;     // Piece on the destination of `move`
+  move_t excluded;   // Move skipped by the singular search
+  move_t killers[2];
+  int static_eval;   // -MATE_SCORE in check, which also marks the check
+} search_stack_t;
+
+// Why the last search stopped, reported by the clock telemetry
+typedef enum {
+  STOP_NONE,
+  STOP_SOFT,   // Soft limit reached after a completed iteration
+  STOP_HARD,   // Hard limit reached inside an iteration
+  STOP_USER,   // `stop`, or any command that ends the search
+  STOP_DEPTH,  // Depth limit reached
+  STOP_NODES,  // Node budget spent
+} stop_reason_t;
+
+// Result of a completed iterative deepening iteration
+typedef struct {
+  move_t best_move, ponder_move;
+  int score;
+  uint64_t nodes;
+  uint64_t time_ms;
+} iteration_t;
+
+typedef struct {
+  uint64_t main_nodes, qs_nodes;
+  uint64_t tt_probes, tt_hits;
+  uint64_t tt_cutoffs[4];  // Indexed by bound
+  uint64_t null_tries, null_cutoffs;
+  uint64_t beta_cutoffs, first_move_cutoffs, cutoff_index_sum;
+  uint64_t depth_nodes[MAX_PLY];  // Nodes spent on each iteration
+  uint8_t depth;
+} search_stats_t;
+
+// Search statistics are compiled out unless built with `-DSEARCH_STATS`
+#ifdef SEARCH_STATS
+#define STATS_INC(ctx, field) ((ctx)->stats.field++)
+#define STATS_ADD(ctx, field, value) ((ctx)->stats.field += (value))
+#else
+#define STATS_INC(ctx, field) ((void)0)
+#define STATS_ADD(ctx, field, value) ((void)0)
+#endif
 
 typedef struct {
   board_t board;
-  pv_table_t pv;
-  killers_t killers;
+  search_stack_t stack[STACK_OFFSET + MAX_PLY + 2];  // See `stack_at`
+  move_t root_pv[MAX_PLY + 1];
+  history_h_t hh;
+  counter_moves_t counter_moves;
+  cont_history_t cont_history[CONT_HISTORY_PLIES];  // 1 and 2 plies back
+  capture_history_t caph;
   time_control_t time_control;
-  uint64_t nodes;
+  iteration_t iterations[MAX_PLY];
+  move_list_t root_moves;  // `searchmoves`, empty for every move
+  pv_line_t lines[MAX_MULTI_PV];
+  uint8_t multi_pv;   // Lines requested, helpers only search one
+  uint8_t lines_len;  // Lines searched, at most the legal root moves
+  uint8_t pv_index;   // Line being searched, the root skips the ones before
+  _Atomic uint64_t nodes;  // Written by its searcher only, read by all
   uint8_t seldepth;
+  uint8_t completed_depth;
+  stop_reason_t stop_reason;
+  uint16_t thread_id;  // 0 for the main searcher, helpers are silent
+#ifdef SEARCH_STATS
+  search_stats_t stats;
+#endif
 } search_ctx_t;
 
+// Plies up to MAX_PLY are searched, and each one sets up its child's entry
+FORCE_INLINE search_stack_t* stack_at(search_ctx_t* ctx, const uint8_t ply) {
+  return &ctx->stack[STACK_OFFSET + ply];
+}
+
 typedef struct {
   board_t board;
 } engine_t;
@@ -47,21 +125,41 @@ typedef struct {
   engine_t* engine;
   time_control_t time_control;
   uint8_t depth;
+  bool infinite;  // bestmove waits for `stop` even after the last iteration
+  move_list_t searchmoves;
+  uint64_t clock_ms, inc_ms, movestogo;  // As sent by `go`, for telemetry
 } uci_go_params_t;
 
 extern volatile _Atomic search_flag_t SEARCH_FLAG;
+extern search_stats_t last_search_stats;
 
 FORCE_INLINE search_flag_t search_flag_load(void) {
   return atomic_load_explicit(&SEARCH_FLAG, memory_order_acquire);
 }
 
-FORCE_INLINE void search_flag_store(const search_flag_t value) {
-  atomic_store_explicit(&SEARCH_FLAG, value, memory_order_release);
-}
+// Also wakes a finished search waiting to send `bestmove`
+void search_flag_store(search_flag_t value);
+
+void init_lmr_table(void);
+
+// Lazy SMP: every searcher has its own context and history and they only
+// share the TT. The pool persists between searches so histories carry over
+bool search_init_threads(uint16_t threads);
+search_ctx_t* search_main(void);
+void search_clear(void);
+uint64_t search_nodes(void);
+void search_set_multi_pv(uint8_t lines);
+// `searchmoves` restricts the root moves when not NULL nor empty
+move_t search_run(const board_t* board, time_control_t time_control,
+                  uint8_t depth, const move_list_t* searchmoves,
+                  move_t* ponder_move);
 
 void* start_search(void* params);
+void search_stats_add(search_stats_t* total, const search_stats_t* stats);
 move_t iterative_deepening(search_ctx_t* ctx, move_t* ponder_move,
                            uint8_t depth);
 int alpha_beta(search_ctx_t* ctx, uint8_t depth, uint8_t ply, int alpha,
                int beta);
-int quiescence(search_ctx_t* ctx, uint8_t ply, int alpha, int beta);
+// `checks` adds the quiet checks to the captures, at the first ply only
+int quiescence(search_ctx_t* ctx, uint8_t ply, int alpha, int beta,
+               bool checks);
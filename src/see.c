@@ -0,0 +1,108 @@
+#include "see.h"
+
+#include <stdbool.h>
+
+#include "bitboard.h"
+#include "board.h"
+#include "defs.h"
+#include "movegen.h"
+
+const int SEE_VALUE[NR_OF_PIECE_TYPES + 1] = {
+    100, 300, 325, 500, 900, 0, 0,
+};
+
+static FORCE_INLINE bitboard_t attackers_to(const board_t* board,
+                                            const square_t sq,
+                                            const bitboard_t occupancy) {
+  const bitboard_t pawns = board->bitboards[PT_PAWN];
+  const bitboard_t diagonals =
+      board->bitboards[PT_BISHOP] | board->bitboards[PT_QUEEN];
+  const bitboard_t orthogonals =
+      board->bitboards[PT_ROOK] | board->bitboards[PT_QUEEN];
+
+  return (gen_piece_attacks(PT_PAWN, CLR_BLACK, occupancy, sq) & pawns &
+          board->occupancies[CLR_WHITE]) |
+         (gen_piece_attacks(PT_PAWN, CLR_WHITE, occupancy, sq) & pawns &
+          board->occupancies[CLR_BLACK]) |
+         (gen_piece_attacks(PT_KNIGHT, CLR_WHITE, occupancy, sq) &
+          board->bitboards[PT_KNIGHT]) |
+         (gen_piece_attacks(PT_BISHOP, CLR_WHITE, occupancy, sq) & diagonals) |
+         (gen_piece_attacks(PT_ROOK, CLR_WHITE, occupancy, sq) & orthogonals) |
+         (gen_piece_attacks(PT_KING, CLR_WHITE, occupancy, sq) &
+          board->bitboards[PT_KING]);
+}
+
+bool see_ge(const board_t* board, const move_t move, const int threshold) {
+  if (is_castling(move)) {
+    return threshold <= 0;
+  }
+
+  const square_t from = get_from(move), to = get_to(move);
+  const uint8_t flags = get_flags(move);
+  const piece_t victim = (flags == FLAG_EP) ? PT_PAWN : board->mailbox[to];
+
+  // `swap` is what the side to recapture must win back to flip the result
+  int swap = SEE_VALUE[victim] - threshold;
+  if (swap < 0) {
+    return false;
+  }
+  swap = SEE_VALUE[board->mailbox[from]] - swap;
+  if (swap <= 0) {
+    return true;
+  }
+
+  bitboard_t occupancy = board->occupancy ^ bit(from) ^ bit(to);
+  if (flags == FLAG_EP) {
+    occupancy ^= bit(to - get_pawn_direction(board->side_to_move));
+  }
+
+  const bitboard_t diagonals =
+      board->bitboards[PT_BISHOP] | board->bitboards[PT_QUEEN];
+  const bitboard_t orthogonals =
+      board->bitboards[PT_ROOK] | board->bitboards[PT_QUEEN];
+  bitboard_t attackers = attackers_to(board, to, occupancy);
+  color_t color = board->side_to_move;
+  int result = 1;
+
+  // Both sides recapture with their least valuable attacker, uncovering the
+  // sliders behind it, until one side runs out of attackers or would lose
+  while (true) {
+    color ^= 1;
+    attackers &= occupancy;
+
+    const bitboard_t own = attackers & board->occupancies[color];
+    if (!own) {
+      break;
+    }
+    result ^= 1;
+
+    piece_t piece = PT_PAWN;
+    while (!(own & board->bitboards[piece])) {
+      piece++;
+    }
+
+    if (piece == PT_KING) {
+      // The king may only recapture when nothing defends the square
+      return (attackers & ~board->occupancies[color]) ? result ^ 1 : result;
+    }
+
+    swap = SEE_VALUE[piece] - swap;
+    if (swap < result) {
+      break;
+    }
+
+    bitboard_t lsb = own & board->bitboards[piece];
+    occupancy ^= bit(pop_lsb(&lsb));
+
+    if (piece == PT_PAWN || piece == PT_BISHOP || piece == PT_QUEEN) {
+      attackers |=
+          gen_piece_attacks(PT_BISHOP, color, occupancy, to) & diagonals;
+    }
+    if (piece == PT_ROOK || piece == PT_QUEEN) {
+      attackers |=
+          gen_piece_attacks(PT_ROOK, color, occupancy, to) & orthogonals;
+    }
+  }
+
+  return result;
+}
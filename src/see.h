@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "board.h"
+#include "defs.h"
+
+// Material values used by the exchange evaluation and delta pruning
+extern const int SEE_VALUE[NR_OF_PIECE_TYPES + 1];
+
+// Static exchange evaluation: whether the capture sequence started by `move`
+// on its target square wins at least `threshold` centipawns for the mover
+bool see_ge(const board_t* board, move_t move, int threshold);
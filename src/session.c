@@ -0,0 +1,437 @@
+#include "session.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "misc.h"
+#include "uci.h"
+
+#if !defined(_WIN32)
+
+#define SESSION_LINE_LEN 8192
+#define LATENCY_BUCKETS 40
+#define NOT_PENDING UINT64_MAX
+
+typedef enum { LAT_GO, LAT_STOP, LAT_READY, LAT_KINDS } latency_kind_t;
+
+static const char* const LATENCY_NAMES[LAT_KINDS] = {
+    "go -> bestmove",
+    "stop -> bestmove",
+    "isready -> readyok",
+};
+
+typedef struct {
+  uint64_t buckets[LATENCY_BUCKETS];  // Bucket k counts [2^k, 2^(k+1)) us
+  uint64_t count, sum_us, max_us;
+} histogram_t;
+
+// Pairs every request with the next matching reply
+typedef struct {
+  histogram_t hists[LAT_KINDS];
+  uint64_t go_us, stop_us, ready_us;
+} latency_t;
+
+typedef void (*line_fn_t)(char dir, const char* line);
+
+typedef struct {
+  int in_fd, out_fd;  // Nothing is forwarded when `out_fd` is negative
+  char dir;
+  line_fn_t on_line;
+} tee_t;
+
+typedef struct {
+  uint64_t t_us;
+  char dir;
+  char* line;
+} event_t;
+
+typedef struct {
+  const event_t* events;
+  size_t len;
+  int fd;
+} feeder_t;
+
+static uint64_t session_start_ns = 0;
+
+static FILE* record_file = NULL;
+static pthread_mutex_t record_lock = PTHREAD_MUTEX_INITIALIZER;
+static tee_t stdin_tee, stdout_tee;
+static pthread_t stdout_thread;
+static int saved_stdout = -1;
+
+static latency_t replayed;
+static pthread_mutex_t replay_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t session_us(void) {
+  return (now_ns() - session_start_ns) / 1000;
+}
+
+static bool is_command(const char* line, const char* cmd) {
+  const size_t len = strlen(cmd);
+  return strncmp(line, cmd, len) == 0 &&
+         (line[len] == ' ' || line[len] == '\0');
+}
+
+static void histogram_add(histogram_t* hist, const uint64_t us) {
+  uint8_t bucket = 0;
+  while (bucket + 1 < LATENCY_BUCKETS && (us >> (bucket + 1)) != 0) {
+    bucket++;
+  }
+
+  hist->buckets[bucket]++;
+  hist->count++;
+  hist->sum_us += us;
+  hist->max_us = (us > hist->max_us) ? us : hist->max_us;
+}
+
+static void latency_init(latency_t* lat) {
+  *lat = (latency_t){.go_us = NOT_PENDING,
+                     .stop_us = NOT_PENDING,
+                     .ready_us = NOT_PENDING};
+}
+
+static void latency_event(latency_t* lat, const uint64_t t_us, const char dir,
+                          const char* line) {
+  if (dir == '<') {
+    if (is_command(line, "go")) {
+      lat->go_us = t_us;
+      lat->stop_us = NOT_PENDING;
+    } else if (is_command(line, "stop") && lat->go_us != NOT_PENDING) {
+      lat->stop_us = t_us;
+    } else if (is_command(line, "isready")) {
+      lat->ready_us = t_us;
+    }
+    return;
+  }
+
+  if (is_command(line, "bestmove")) {
+    if (lat->go_us != NOT_PENDING) {
+      histogram_add(&lat->hists[LAT_GO], t_us - lat->go_us);
+    }
+    if (lat->stop_us != NOT_PENDING) {
+      histogram_add(&lat->hists[LAT_STOP], t_us - lat->stop_us);
+    }
+    lat->go_us = lat->stop_us = NOT_PENDING;
+  } else if (is_command(line, "readyok") && lat->ready_us != NOT_PENDING) {
+    histogram_add(&lat->hists[LAT_READY], t_us - lat->ready_us);
+    lat->ready_us = NOT_PENDING;
+  }
+}
+
+static bool write_all(const int fd, const char* buf, size_t len) {
+  while (len > 0) {
+    const ssize_t written = write(fd, buf, len);
+    if (written <= 0) {
+      return false;
+    }
+    buf += written;
+    len -= (size_t)written;
+  }
+  return true;
+}
+
+// Copies `in_fd` to `out_fd` until EOF, every complete line is passed to
+// `on_line` before being forwarded so inputs are timestamped first
+static void* tee_thread(void* arg) {
+  const tee_t* tee = arg;
+  char buf[SESSION_LINE_LEN], line[SESSION_LINE_LEN];
+  size_t len = 0;
+  ssize_t read_len;
+
+  while ((read_len = read(tee->in_fd, buf, sizeof buf)) > 0) {
+    for (ssize_t i = 0; i < read_len; i++) {
+      if (buf[i] == '\n') {
+        line[len] = '\0';
+        tee->on_line(tee->dir, line);
+        len = 0;
+      } else if (buf[i] != '\r' && len + 1 < sizeof line) {
+        line[len++] = buf[i];
+      }
+    }
+
+    if (tee->out_fd >= 0 && !write_all(tee->out_fd, buf, (size_t)read_len)) {
+      break;
+    }
+  }
+
+  if (len > 0) {
+    line[len] = '\0';
+    tee->on_line(tee->dir, line);
+  }
+
+  close(tee->in_fd);
+  if (tee->out_fd >= 0) {
+    close(tee->out_fd);
+  }
+  return NULL;
+}
+
+static void record_line(const char dir, const char* line) {
+  const uint64_t t_us = session_us();
+
+  pthread_mutex_lock(&record_lock);
+  if (record_file) {
+    fprintf(record_file, "%" PRIu64 " %c %s\n", t_us, dir, line);
+    fflush(record_file);
+  }
+  pthread_mutex_unlock(&record_lock);
+}
+
+bool session_record_start(const char* path) {
+  record_file = fopen(path, "w");
+  if (record_file == NULL) {
+    UCI_SEND("info string cannot open %s", path);
+    return false;
+  }
+
+  int in_pipe[2], out_pipe[2];
+  if (pipe(in_pipe) != 0 || pipe(out_pipe) != 0) {
+    UCI_SEND("info string cannot create session pipes");
+    return false;
+  }
+
+  session_start_ns = now_ns();
+  saved_stdout = dup(STDOUT_FILENO);
+  stdin_tee = (tee_t){dup(STDIN_FILENO), in_pipe[1], '<', record_line};
+  stdout_tee = (tee_t){out_pipe[0], dup(saved_stdout), '>', record_line};
+
+  // Threads first: stdout must not point at a pipe nobody drains
+  pthread_t stdin_thread;
+  if (pthread_create(&stdin_thread, NULL, tee_thread, &stdin_tee) != 0 ||
+      pthread_create(&stdout_thread, NULL, tee_thread, &stdout_tee) != 0) {
+    UCI_SEND("info string error starting session threads");
+    return false;
+  }
+  pthread_detach(stdin_thread);
+
+  fflush(stdout);
+  dup2(in_pipe[0], STDIN_FILENO);
+  dup2(out_pipe[1], STDOUT_FILENO);
+  close(in_pipe[0]);
+  close(out_pipe[1]);
+  return true;
+}
+
+void session_record_stop(void) {
+  if (record_file == NULL) {
+    return;
+  }
+
+  // Closing the last write end of the stdout pipe ends its tee
+  fflush(stdout);
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  pthread_join(stdout_thread, NULL);
+
+  pthread_mutex_lock(&record_lock);
+  fclose(record_file);
+  record_file = NULL;
+  pthread_mutex_unlock(&record_lock);
+}
+
+static void free_recording(event_t* events, const size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    free(events[i].line);
+  }
+  free(events);
+}
+
+static bool load_recording(const char* path, event_t** events, size_t* len) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    UCI_SEND("info string cannot open %s", path);
+    return false;
+  }
+
+  char buf[SESSION_LINE_LEN];
+  size_t capacity = 0;
+  *events = NULL;
+  *len = 0;
+
+  while (fgets(buf, sizeof buf, file)) {
+    buf[strcspn(buf, "\r\n")] = 0;
+
+    char* end;
+    const uint64_t t_us = strtoull(buf, &end, 10);
+    if (end == buf || end[0] != ' ' || (end[1] != '<' && end[1] != '>')) {
+      continue;
+    }
+    const char* line = (end[2] == ' ') ? end + 3 : "";
+
+    if (*len == capacity) {
+      capacity = capacity ? capacity * 2 : 256;
+      event_t* grown = realloc(*events, capacity * sizeof(event_t));
+      if (grown == NULL) {
+        fclose(file);
+        free_recording(*events, *len);
+        UCI_SEND("info string failed to allocate recording");
+        return false;
+      }
+      *events = grown;
+    }
+
+    char* copy = malloc(strlen(line) + 1);
+    if (copy == NULL) {
+      fclose(file);
+      free_recording(*events, *len);
+      UCI_SEND("info string failed to allocate recording");
+      return false;
+    }
+    strcpy(copy, line);
+    (*events)[(*len)++] = (event_t){t_us, end[1], copy};
+  }
+
+  fclose(file);
+  return true;
+}
+
+static void replay_line(const char dir, const char* line) {
+  const uint64_t t_us = session_us();
+
+  pthread_mutex_lock(&replay_lock);
+  latency_event(&replayed, t_us, dir, line);
+  pthread_mutex_unlock(&replay_lock);
+}
+
+static void sleep_until_ns(const uint64_t deadline_ns) {
+  const struct timespec ts = {(time_t)(deadline_ns / 1000000000),
+                              (long)(deadline_ns % 1000000000)};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+  }
+}
+
+// Writes the recorded inputs to the engine at their original offsets
+static void* feeder_thread(void* arg) {
+  const feeder_t* feeder = arg;
+
+  for (size_t i = 0; i < feeder->len; i++) {
+    const event_t* event = &feeder->events[i];
+    if (event->dir != '<') {
+      continue;
+    }
+
+    sleep_until_ns(session_start_ns + event->t_us * 1000);
+    replay_line('<', event->line);
+
+    if (!write_all(feeder->fd, event->line, strlen(event->line)) ||
+        !write_all(feeder->fd, "\n", 1) || is_command(event->line, "quit")) {
+      break;
+    }
+  }
+
+  close(feeder->fd);
+  return NULL;
+}
+
+static void print_histogram_summary(const char* label,
+                                    const histogram_t* hist) {
+  printf("  %-9s %7" PRIu64 " samples, mean %9" PRIu64 " us, max %9" PRIu64
+         " us\n",
+         label, hist->count, hist->count ? hist->sum_us / hist->count : 0,
+         hist->max_us);
+}
+
+static void print_latency(const latency_t* recorded) {
+  for (uint8_t kind = 0; kind < LAT_KINDS; kind++) {
+    const histogram_t* rec = &recorded->hists[kind];
+    const histogram_t* rep = &replayed.hists[kind];
+
+    printf("\n%s\n", LATENCY_NAMES[kind]);
+    print_histogram_summary("recorded", rec);
+    print_histogram_summary("replayed", rep);
+
+    for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+      if (rec->buckets[b] == 0 && rep->buckets[b] == 0) {
+        continue;
+      }
+      const uint64_t lower = b ? (uint64_t)1 << b : 0;
+      printf("  [%10" PRIu64 ", %10" PRIu64 ") us %7" PRIu64 " %7" PRIu64
+             "\n",
+             lower, (uint64_t)1 << (b + 1), rec->buckets[b], rep->buckets[b]);
+    }
+  }
+}
+
+bool session_replay(const char* path, engine_t* engine) {
+  event_t* events;
+  size_t len;
+  if (!load_recording(path, &events, &len)) {
+    return false;
+  }
+
+  latency_t recorded;
+  latency_init(&recorded);
+  for (size_t i = 0; i < len; i++) {
+    latency_event(&recorded, events[i].t_us, events[i].dir, events[i].line);
+  }
+  latency_init(&replayed);
+
+  int in_pipe[2], out_pipe[2];
+  if (pipe(in_pipe) != 0 || pipe(out_pipe) != 0) {
+    UCI_SEND("info string cannot create session pipes");
+    free_recording(events, len);
+    return false;
+  }
+
+  session_start_ns = now_ns();
+  const feeder_t feeder = {events, len, in_pipe[1]};
+  const tee_t reader = {out_pipe[0], -1, '>', replay_line};
+  pthread_t feeder_worker, reader_worker;
+  if (pthread_create(&reader_worker, NULL, tee_thread, (void*)&reader) != 0 ||
+      pthread_create(&feeder_worker, NULL, feeder_thread, (void*)&feeder) !=
+          0) {
+    UCI_SEND("info string error starting session threads");
+    free_recording(events, len);
+    return false;
+  }
+
+  // The engine output is only consumed for the latencies
+  const int real_stdout = dup(STDOUT_FILENO);
+  fflush(stdout);
+  dup2(in_pipe[0], STDIN_FILENO);
+  dup2(out_pipe[1], STDOUT_FILENO);
+  close(in_pipe[0]);
+  close(out_pipe[1]);
+
+  uci_loop(engine);
+
+  fflush(stdout);
+  dup2(real_stdout, STDOUT_FILENO);
+  close(real_stdout);
+  pthread_join(feeder_worker, NULL);
+  pthread_join(reader_worker, NULL);
+
+  printf("Replayed %zu lines of %s\n", len, path);
+  print_latency(&recorded);
+  free_recording(events, len);
+  return true;
+}
+
+#else
+
+bool session_record_start(const char* path) {
+  (void)path;
+  UCI_SEND("info string session recording is not supported on Windows");
+  return false;
+}
+
+void session_record_stop(void) {}
+
+bool session_replay(const char* path, engine_t* engine) {
+  (void)path;
+  (void)engine;
+  UCI_SEND("info string session replay is not supported on Windows");
+  return false;
+}
+
+#endif
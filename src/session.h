@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "search.h"
+
+// A recording has one line per stdin/stdout line of the UCI loop:
+// `<microseconds since start> <'<' for input, '>' for output> <line>`
+// Recording and replay rely on POSIX pipes and are unavailable on Windows
+
+// Tees stdin and stdout into `path` until session_record_stop()
+bool session_record_start(const char* path);
+void session_record_stop(void);
+
+// Feeds the input lines of a recording to the UCI loop at their original
+// times and reports the go/stop/isready latency histograms, both recorded
+// and replayed
+bool session_replay(const char* path, engine_t* engine);
@@ -0,0 +1,65 @@
+#include "telemetry.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "search.h"
+
+static const char* const STOP_REASON_NAMES[] = {
+    "none", "soft", "hard", "stop", "depth", "nodes",
+};
+
+static FILE* telemetry_file = NULL;
+static pthread_mutex_t telemetry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+bool telemetry_open(const char* path) {
+  pthread_mutex_lock(&telemetry_lock);
+  if (telemetry_file) {
+    fclose(telemetry_file);
+    telemetry_file = NULL;
+  }
+
+  bool ok = true;
+  if (path[0] != '\0' && strcmp(path, "<empty>") != 0) {
+    telemetry_file = fopen(path, "a");
+    ok = telemetry_file != NULL;
+
+    // Header only for a new file, appended sessions share it
+    if (ok && ftell(telemetry_file) == 0) {
+      fprintf(telemetry_file,
+              "clock_ms,inc_ms,movestogo,soft_ms,hard_ms,used_ms,depth,"
+              "seldepth,nodes,stop\n");
+    }
+  }
+  pthread_mutex_unlock(&telemetry_lock);
+
+  return ok;
+}
+
+// Infinite limits are written as empty fields
+static void write_limit(FILE* file, const uint64_t ms) {
+  if (ms != UINT64_MAX) {
+    fprintf(file, "%" PRIu64, ms);
+  }
+  fputc(',', file);
+}
+
+// Called after `bestmove` is sent so the write never delays it
+void telemetry_record(const telemetry_t* entry) {
+  pthread_mutex_lock(&telemetry_lock);
+  if (telemetry_file) {
+    fprintf(telemetry_file, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",",
+            entry->clock_ms, entry->inc_ms, entry->movestogo);
+    write_limit(telemetry_file, entry->soft_ms);
+    write_limit(telemetry_file, entry->hard_ms);
+    fprintf(telemetry_file, "%" PRIu64 ",%d,%d,%" PRIu64 ",%s\n",
+            entry->used_ms, entry->depth, entry->seldepth, entry->nodes,
+            STOP_REASON_NAMES[entry->stop_reason]);
+    fflush(telemetry_file);
+  }
+  pthread_mutex_unlock(&telemetry_lock);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "search.h"
+
+typedef struct {
+  uint64_t clock_ms, inc_ms, movestogo;
+  uint64_t soft_ms, hard_ms, used_ms;
+  uint64_t nodes;
+  uint8_t depth, seldepth;
+  stop_reason_t stop_reason;
+} telemetry_t;
+
+// Appends one CSV line per move to `path`, an empty path or `<empty>` turns
+// the log off
+bool telemetry_open(const char* path);
+void telemetry_record(const telemetry_t* entry);
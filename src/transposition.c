@@ -1,6 +1,7 @@
 #include "transposition.h"
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -16,6 +17,24 @@
 // Global transposition table
 t_table_t tt = {NULL, 0, 0};
 
+static FORCE_INLINE uint64_t tt_pack(const move_t best_move,
+                                     const int16_t score, const uint8_t depth,
+                                     const uint8_t bound, const uint8_t age) {
+  return (uint64_t)best_move | (uint64_t)(uint16_t)score << 16 |
+         (uint64_t)depth << 32 | (uint64_t)bound << 40 | (uint64_t)age << 48;
+}
+
+static FORCE_INLINE tt_entry_t tt_load(tt_slot_t* slot) {
+  const uint64_t data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+  const uint64_t key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+  return (tt_entry_t){key ^ data,
+                      (move_t)data,
+                      (int16_t)(uint16_t)(data >> 16),
+                      (uint8_t)(data >> 32),
+                      (uint8_t)(data >> 40),
+                      (uint8_t)(data >> 48)};
+}
+
 void tt_update(void) { tt.age += 1; }
 void tt_prefetch(const uint64_t hash) {
   assert(tt.buckets && "TT must be initialized before search");
@@ -74,8 +93,8 @@ uint16_t get_hashfull(void) {
 
   for (uint16_t i = 0; i < 1000; i++) {
     for (uint8_t j = 0; j < BUCKETS_LEN; j++) {
-      count += tt.buckets[i][j].bound != BOUND_NONE &&
-               tt.buckets[i][j].age == tt.age;
+      const tt_entry_t entry = tt_load(&tt.buckets[i][j]);
+      count += entry.bound != BOUND_NONE && entry.age == tt.age;
     }
   }
 
@@ -89,7 +108,7 @@ tt_entry_t tt_probe(const uint64_t zobrist) {
 
   tt_bucket_t* bucket = &tt.buckets[zobrist & tt.mask];
   for (uint8_t i = 0; i < BUCKETS_LEN; i++) {
-    const tt_entry_t entry = (*bucket)[i];
+    const tt_entry_t entry = tt_load(&(*bucket)[i]);
     if (entry.key == zobrist && entry.bound != BOUND_NONE) {
       return entry;
     }
@@ -110,27 +129,26 @@ void tt_store(const uint64_t zobrist, const move_t best_move, const int score,
   }
 
   tt_bucket_t* bucket = &tt.buckets[zobrist & tt.mask];
-  tt_entry_t* replace = NULL;
+  tt_slot_t* replace = NULL;
   int replace_priority = INT32_MAX;
 
   for (uint8_t i = 0; i < BUCKETS_LEN; i++) {
-    tt_entry_t* entry = (*bucket) + i;
-    if (entry->bound == BOUND_NONE || entry->key == zobrist) {
-      replace = entry;
+    tt_slot_t* slot = (*bucket) + i;
+    const tt_entry_t entry = tt_load(slot);
+    if (entry.bound == BOUND_NONE || entry.key == zobrist) {
+      replace = slot;
       break;
     }
-    const int entry_priority = tt_priority(entry);
+    const int entry_priority = tt_priority(&entry);
     if (entry_priority < replace_priority) {
-      replace = entry;
+      replace = slot;
       replace_priority = entry_priority;
     }
   }
 
   assert(replace != NULL);
-  replace->key = zobrist;
-  replace->best_move = best_move;
-  replace->score = encode_mate(score, ply);
-  replace->depth = depth;
-  replace->bound = bound;
-  replace->age = tt.age;
+  const uint64_t data =
+      tt_pack(best_move, encode_mate(score, ply), depth, bound, tt.age);
+  atomic_store_explicit(&replace->key, zobrist ^ data, memory_order_relaxed);
+  atomic_store_explicit(&replace->data, data, memory_order_relaxed);
 }
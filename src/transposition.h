@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdalign.h>
+#include <stdatomic.h>
 #include <stdint.h>
 
 #include "defs.h"
@@ -26,7 +27,14 @@ typedef struct {
   uint8_t age;
 } tt_entry_t;
 
-typedef tt_entry_t tt_bucket_t[BUCKETS_LEN];
+// Entries are shared by the search threads without locking: the key is
+// stored XORed with the packed data, so a torn entry fails verification
+typedef struct {
+  _Atomic uint64_t key;
+  _Atomic uint64_t data;
+} tt_slot_t;
+
+typedef tt_slot_t tt_bucket_t[BUCKETS_LEN];
 
 typedef struct {
   tt_bucket_t* buckets;
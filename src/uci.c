@@ -8,20 +8,33 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bench.h"
 #include "board.h"
 #include "defs.h"
-#include "history.h"
+#include "epd.h"
 #include "misc.h"
 #include "movegen.h"
+#include "perft.h"
 #include "search.h"
+#include "telemetry.h"
 #include "transposition.h"
 
 #define LINE_BUF_LEN 8192
-#define FEN_BUF_LEN 128
 
 uint64_t move_overhead_ms = 100;
-
-static void stop_worker(void) { search_flag_store(ST_EXIT); }
+static size_t hash_mb = DEFAULT_TT_SIZE;
+static pthread_t worker;
+static bool worker_running = false;
+
+// Ends the search, if any, and waits until its `bestmove` is sent so the next
+// command never races the previous search over the shared searchers
+static void stop_worker(void) {
+  search_flag_store(ST_EXIT);
+  if (worker_running) {
+    pthread_join(worker, NULL);
+    worker_running = false;
+  }
+}
 
 static bool parse_fen_tokens(char* fen, char** saveptr) {
   int fields = 0;
@@ -47,27 +60,32 @@ static bool parse_fen_tokens(char* fen, char** saveptr) {
   return fields >= 4;
 }
 
-static bool apply_move_list(board_t* board, char** saveptr) {
-  char* token;
-  while ((token = strtok_r(NULL, " ", saveptr)) != NULL) {
-    uint8_t i = 0;
-    const move_list_t move_list = gen_color_moves(board);
+// Returns 0 when `token` isn't a pseudo-legal move of the position
+static move_t parse_move(const board_t* board, const char* token) {
+  const move_list_t move_list = gen_color_moves(board);
 
-    for (; i < move_list.len; i++) {
-      const move_t move = move_list.moves[i];
-      char move_uci[6] = {0};
-      move_to_uci(move, move_uci);
+  for (uint8_t i = 0; i < move_list.len; i++) {
+    const move_t move = move_list.moves[i];
+    char move_uci[6] = {0};
+    move_to_uci(move, move_uci);
 
-      if (strcmp(token, move_uci) == 0) {
-        do_move(move, board);
-        break;
-      }
+    if (strcmp(token, move_uci) == 0) {
+      return move;
     }
+  }
 
-    if (i == move_list.len) {
+  return 0;
+}
+
+static bool apply_move_list(board_t* board, char** saveptr) {
+  char* token;
+  while ((token = strtok_r(NULL, " ", saveptr)) != NULL) {
+    const move_t move = parse_move(board, token);
+    if (!move) {
       UCI_SEND("info string invalid move %s", token);
       return false;
     }
+    do_move(move, board);
   }
   return true;
 }
@@ -102,16 +120,51 @@ bad_argument:
   UCI_SEND("info string unknown position argument");
 }
 
-static void handle_go(engine_t* engine, pthread_t* worker,
-                      uci_go_params_t* params, char** saveptr) {
+static void handle_perft(const engine_t* engine, char** saveptr,
+                         const bool divide) {
+  const char* token = strtok_r(NULL, " ", saveptr);
+  if (!token) {
+    UCI_SEND("info string missing perft depth");
+    return;
+  }
+
+  perft_report(&engine->board, (uint8_t)atoi(token), divide);
+}
+
+static void handle_perft_scaling(const engine_t* engine, char** saveptr) {
+  const char* token = strtok_r(NULL, " ", saveptr);
+  if (!token) {
+    UCI_SEND("info string missing perft depth");
+    return;
+  }
+
+  const uint8_t depth = (uint8_t)atoi(token);
+  uint16_t threads = 1;
+  size_t perft_hash_mb = PERFT_DEFAULT_HASH;
+
+  if ((token = strtok_r(NULL, " ", saveptr)) != NULL) {
+    threads = (uint16_t)atoi(token);
+    if ((token = strtok_r(NULL, " ", saveptr)) != NULL) {
+      perft_hash_mb = (size_t)atoll(token);
+    }
+  }
+
+  perft_scaling(&engine->board, depth, threads, perft_hash_mb);
+}
+
+static void handle_go(engine_t* engine, uci_go_params_t* params,
+                      char** saveptr) {
   const uint64_t start_ms = now_ms();
   uint64_t wtime = 0, btime = 0, winc = 0, binc = 0, mtg = 0;
-  uint64_t movetime = 0;
+  uint64_t movetime = 0, nodes = 0;
   uint8_t depth = MAX_PLY - 1;
+  bool infinite = false;
+  move_list_t searchmoves = {{0}, 0};
 
   search_flag_store(ST_THINK);
-  char* token;
-  while ((token = strtok_r(NULL, " ", saveptr)) != NULL) {
+  char *token, *next = NULL;
+  while ((token = next ? next : strtok_r(NULL, " ", saveptr)) != NULL) {
+    next = NULL;
     if (strcmp(token, "wtime") == 0) {
       const char* val = strtok_r(NULL, " ", saveptr);
       if (val) {
@@ -148,8 +201,35 @@ static void handle_go(engine_t* engine, pthread_t* worker,
       if (val) {
         movetime = (uint64_t)atoll(val);
       }
+    } else if (strcmp(token, "nodes") == 0) {
+      const char* val = strtok_r(NULL, " ", saveptr);
+      if (val) {
+        nodes = (uint64_t)atoll(val);
+      }
+    } else if (strcmp(token, "infinite") == 0) {
+      infinite = true;
+    } else if (strcmp(token, "searchmoves") == 0) {
+      // The moves run up to the next token that isn't one
+      while ((next = strtok_r(NULL, " ", saveptr)) != NULL) {
+        const move_t move = parse_move(&engine->board, next);
+        if (!move) {
+          break;
+        }
+        bool listed = false;
+        for (uint8_t i = 0; i < searchmoves.len; i++) {
+          listed |= searchmoves.moves[i] == move;
+        }
+        if (!listed && searchmoves.len < MAX_MOVES) {
+          push_move(&searchmoves, move);
+        }
+      }
     } else if (strcmp(token, "ponder") == 0) {
       search_flag_store(ST_PONDER);
+    } else if (strcmp(token, "perft") == 0) {
+      // Perft runs synchronously, no search worker is started
+      search_flag_store(ST_EXIT);
+      handle_perft(engine, saveptr, false);
+      return;
     } else if (strcmp(token, "mate") == 0) {
       const char* val = strtok_r(NULL, " ", saveptr);
       if (val) {
@@ -167,7 +247,9 @@ static void handle_go(engine_t* engine, pthread_t* worker,
   // Infinite search by default
   // Max time is `UINT64_MAX` on infinite search
   // Technically not infinite but it would search for 584,942,417 years.
-  time_control_t time_control = {false, start_ms, UINT64_MAX, UINT64_MAX};
+  time_control_t time_control = {false, start_ms, UINT64_MAX, UINT64_MAX,
+                                 nodes};
+  const uint64_t movestogo = mtg;
 
   if (color_time_ms > 0) {
     const uint64_t base_time = color_time_ms - move_overhead_ms;
@@ -188,15 +270,14 @@ static void handle_go(engine_t* engine, pthread_t* worker,
     time_control.hard_ms = base_time;
   }
 
-  *params = (uci_go_params_t){engine, time_control, depth};
-  if (pthread_create(worker, NULL, start_search, (void*)params) != 0) {
+  *params = (uci_go_params_t){engine, time_control, depth, infinite,
+                              searchmoves, color_time_ms, color_inc_ms,
+                              movestogo};
+  worker_running =
+      pthread_create(&worker, NULL, start_search, (void*)params) == 0;
+  if (!worker_running) {
     UCI_SEND("info string error starting search thread");
   }
-
-  // Detached: lifetime controlled exclusively by SEARCH_FLAG
-  if (pthread_detach(*worker) != 0) {
-    UCI_SEND("info string error detaching search thread");
-  }
 }
 
 static void handle_option(char** saveptr) {
@@ -227,15 +308,17 @@ static void handle_option(char** saveptr) {
   const int val = atoi(token);
 
   if (strcmp(option_name, "Hash") == 0) {
+    stop_worker();  // The TT is reallocated
     if (val < 2) {
       UCI_SEND("info string Hash has to be at least 2 mb, using default 32 mb");
-      tt_init(DEFAULT_TT_SIZE);
+      hash_mb = DEFAULT_TT_SIZE;
     } else if (val > 1024) {
       UCI_SEND("info string Hash capped at 1024 mb");
-      tt_init(1024);
+      hash_mb = 1024;
     } else {
-      tt_init(val);
+      hash_mb = val;
     }
+    tt_init(hash_mb);
     return;
   } else if (strcmp(option_name, "MoveOverhead") == 0) {
     if (val < 0) {
@@ -249,6 +332,34 @@ static void handle_option(char** saveptr) {
       move_overhead_ms = val;
     }
     return;
+  } else if (strcmp(option_name, "Threads") == 0) {
+    stop_worker();  // The searchers are reallocated
+    if (val < 1) {
+      UCI_SEND("info string Threads has to be at least 1, using 1");
+      search_init_threads(1);
+    } else if (val > MAX_THREADS) {
+      UCI_SEND("info string Threads capped at %d", MAX_THREADS);
+      search_init_threads(MAX_THREADS);
+    } else {
+      search_init_threads((uint16_t)val);
+    }
+    return;
+  } else if (strcmp(option_name, "MultiPV") == 0) {
+    if (val < 1) {
+      UCI_SEND("info string MultiPV has to be at least 1, using 1");
+      search_set_multi_pv(1);
+    } else if (val > MAX_MULTI_PV) {
+      UCI_SEND("info string MultiPV capped at %d", MAX_MULTI_PV);
+      search_set_multi_pv(MAX_MULTI_PV);
+    } else {
+      search_set_multi_pv((uint8_t)val);
+    }
+    return;
+  } else if (strcmp(option_name, "TelemetryLog") == 0) {
+    if (!telemetry_open(token)) {
+      UCI_SEND("info string cannot open telemetry log %s", token);
+    }
+    return;
   } else if (strcmp(option_name, "Ponder") == 0) {
     // Pondering is always enabled
     return;
@@ -258,10 +369,49 @@ bad_argument:
   UCI_SEND("info string unknown option argument");
 }
 
+static void handle_bench(char** saveptr) {
+  uint8_t depth = BENCH_DEFAULT_DEPTH;
+  size_t bench_hash_mb = BENCH_DEFAULT_HASH;
+  bool hw_counters = false;
+  uint8_t positional = 0;
+
+  const char* token;
+  while ((token = strtok_r(NULL, " ", saveptr)) != NULL) {
+    if (strcmp(token, "--perf") == 0) {
+      hw_counters = true;
+    } else if (positional++ == 0) {
+      depth = (uint8_t)atoi(token);
+    } else {
+      bench_hash_mb = (size_t)atoll(token);
+    }
+  }
+
+  bench(depth, bench_hash_mb, hw_counters);
+
+  // Bench leaves a resized and polluted TT behind
+  tt_init(hash_mb);
+  search_clear();
+}
+
+static void handle_epd(char** saveptr) {
+  const char* path = strtok_r(NULL, " ", saveptr);
+  const char* movetime = strtok_r(NULL, " ", saveptr);
+  if (!path || !movetime) {
+    UCI_SEND("info string usage: epd <file> <movetime>");
+    return;
+  }
+
+  run_epd(path, (uint64_t)atoll(movetime));
+
+  // Like bench, leave the next search a clean TT
+  tt_clear();
+  search_clear();
+}
+
 void uci_loop(engine_t* engine) {
   char line[LINE_BUF_LEN] = {0};
-  pthread_t worker;
-  uci_go_params_t uci_go_struct = {engine, {0, 0, 0, 0}, 0};
+  uci_go_params_t uci_go_struct = {
+      engine, {0, 0, 0, 0, 0}, 0, false, {{0}, 0}, 0, 0, 0};
   char* saveptr = NULL;
 
   while (fgets(line, sizeof line, stdin)) {
@@ -278,16 +428,20 @@ void uci_loop(engine_t* engine) {
       UCI_SEND("option name Hash type spin default 32 min 2 max 1024");
       UCI_SEND(
           "option name MoveOverhead type spin default 100 min 0 max 10000");
+      UCI_SEND("option name Threads type spin default 1 min 1 max 256");
+      UCI_SEND("option name MultiPV type spin default 1 min 1 max %d",
+               MAX_MULTI_PV);
+      UCI_SEND("option name TelemetryLog type string default <empty>");
       UCI_SEND("uciok");
     } else if (strcmp(token, "isready") == 0) {
-      stop_worker();
+      // Answered right away, without stopping a search
       UCI_SEND("readyok");
     } else if (strcmp(token, "position") == 0) {
       stop_worker();
       handle_position(engine, &saveptr);
     } else if (strcmp(token, "go") == 0) {
       stop_worker();
-      handle_go(engine, &worker, &uci_go_struct, &saveptr);
+      handle_go(engine, &uci_go_struct, &saveptr);
     } else if (strcmp(token, "quit") == 0) {
       stop_worker();
       break;
@@ -299,12 +453,32 @@ void uci_loop(engine_t* engine) {
       }
     } else if (strcmp(token, "ucinewgame") == 0) {
       stop_worker();
-      hh_clear();
+      search_clear();
       tt_clear();
     } else if (strcmp(token, "setoption") == 0) {
       handle_option(&saveptr);
     } else if (strcmp(token, "board") == 0) {
       print_board(&engine->board);
+    } else if (strcmp(token, "divide") == 0) {
+      stop_worker();
+      handle_perft(engine, &saveptr, true);
+    } else if (strcmp(token, "perft") == 0) {
+      stop_worker();
+      handle_perft_scaling(engine, &saveptr);
+    } else if (strcmp(token, "epd") == 0) {
+      stop_worker();
+      handle_epd(&saveptr);
+    } else if (strcmp(token, "stats") == 0) {
+#ifdef SEARCH_STATS
+      // The worker writes the stats once its search ends
+      stop_worker();
+      send_info_stats(&last_search_stats);
+#else
+      UCI_SEND("info string search stats not compiled in, build with STATS=1");
+#endif
+    } else if (strcmp(token, "bench") == 0) {
+      stop_worker();
+      handle_bench(&saveptr);
     } else {
       UCI_SEND("info string unknown command");
     }
@@ -312,23 +486,35 @@ void uci_loop(engine_t* engine) {
   stop_worker();
 }
 
-void send_info_depth(search_ctx_t* ctx, const uint8_t depth, const int score) {
+void send_info_depth(search_ctx_t* ctx, const uint8_t depth,
+                     const uint8_t line_idx) {
+  const pv_line_t* line = &ctx->lines[line_idx];
+  const int score = line->score;
   const int score_sign = (score > 0) - (score < 0);
   const int encoded_score = (abs(score) > MATE_THRESHOLD)
                                 ? (MATE_SCORE - abs(score) + 1) / 2 * score_sign
                                 : score;
   const uint64_t search_duration_ms = now_ms() - ctx->time_control.start_ms + 1;
-  const uint64_t nps = (ctx->nodes * 1000) / search_duration_ms;
+  const uint64_t nodes = search_nodes();
+  const uint64_t nps = (nodes * 1000) / search_duration_ms;
 
-  printf("info depth %d seldepth %d score %s %d time %" PRIu64 " nodes %" PRIu64
-         " nps %" PRIu64 " hashfull %d pv ",
-         depth, ctx->seldepth, (abs(score) > MATE_THRESHOLD) ? "mate" : "cp",
-         encoded_score, search_duration_ms, ctx->nodes, nps, get_hashfull());
+  // Aspiration re-searches report the bound the score failed on
+  const char* bound_str = (line->bound == BOUND_LOWER)   ? " lowerbound"
+                          : (line->bound == BOUND_UPPER) ? " upperbound"
+                                                         : "";
 
-  for (uint8_t i = 0; i < ctx->pv.len[0]; i++) {
-    const move_t move = ctx->pv.table[0][i];
+  printf("info depth %d seldepth %d ", depth, ctx->seldepth);
+  if (ctx->lines_len > 1) {
+    printf("multipv %d ", line_idx + 1);
+  }
+  printf("score %s %d%s time %" PRIu64 " nodes %" PRIu64 " nps %" PRIu64
+         " hashfull %d pv ",
+         (abs(score) > MATE_THRESHOLD) ? "mate" : "cp", encoded_score,
+         bound_str, search_duration_ms, nodes, nps, get_hashfull());
+
+  for (uint8_t i = 0; i < line->len; i++) {
     char move_uci[6] = {0};
-    move_to_uci(move, move_uci);
+    move_to_uci(line->moves[i], move_uci);
 
     printf("%s ", move_uci);
   }
@@ -343,3 +529,39 @@ void send_info_currmove(const move_t move, const uint8_t currmovenumber) {
 
   UCI_SEND("info currmove %s currmovenumber %d", move_uci, currmovenumber);
 }
+
+static double ratio(const uint64_t num, const uint64_t den) {
+  return den ? (double)num / den : 0.0;
+}
+
+void send_info_stats(const search_stats_t* stats) {
+  const uint64_t cutoffs = stats->beta_cutoffs;
+  const uint8_t depth = stats->depth;
+  const double ebf = (depth >= 2) ? ratio(stats->depth_nodes[depth],
+                                          stats->depth_nodes[depth - 1])
+                                  : 0.0;
+
+  UCI_SEND("info string stats tt probes %" PRIu64 " hits %.1f%% cutoffs exact %"
+           PRIu64 " lower %" PRIu64 " upper %" PRIu64,
+           stats->tt_probes, ratio(stats->tt_hits, stats->tt_probes) * 100,
+           stats->tt_cutoffs[BOUND_EXACT], stats->tt_cutoffs[BOUND_LOWER],
+           stats->tt_cutoffs[BOUND_UPPER]);
+  UCI_SEND("info string stats null tries %" PRIu64 " cutoffs %.1f%%",
+           stats->null_tries,
+           ratio(stats->null_cutoffs, stats->null_tries) * 100);
+  UCI_SEND("info string stats beta cutoffs %" PRIu64
+           " first move %.1f%% avg index %.2f",
+           cutoffs, ratio(stats->first_move_cutoffs, cutoffs) * 100,
+           ratio(stats->cutoff_index_sum, cutoffs));
+  UCI_SEND("info string stats nodes %" PRIu64 " qnodes %" PRIu64
+           " qnodes/nodes %.2f ebf %.2f",
+           stats->main_nodes, stats->qs_nodes,
+           ratio(stats->qs_nodes, stats->main_nodes), ebf);
+
+  printf("info string stats depth nodes");
+  for (uint8_t d = 1; d <= depth; d++) {
+    printf(" %" PRIu64, stats->depth_nodes[d]);
+  }
+  putchar('\n');
+  fflush(stdout);
+}
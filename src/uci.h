@@ -6,6 +6,8 @@
 #include "defs.h"
 #include "search.h"
 
+#define FEN_BUF_LEN 128
+
 #define UCI_SEND(...)    \
   do {                   \
     printf(__VA_ARGS__); \
@@ -60,5 +62,7 @@ FORCE_INLINE void move_to_uci(const move_t move, char out[6]) {
 }
 
 void uci_loop(engine_t* engine);
-void send_info_depth(search_ctx_t* ctx, uint8_t depth, int score);
+// Reports a root line, with its rank when searching several
+void send_info_depth(search_ctx_t* ctx, uint8_t depth, uint8_t line_idx);
 void send_info_currmove(move_t move, uint8_t currmovenumber);
+void send_info_stats(const search_stats_t* stats);